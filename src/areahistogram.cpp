@@ -0,0 +1,92 @@
+#include "areahistogram.h"
+
+
+AreaHistogram::AreaHistogram():counts(0) {
+    //Default constructor, no window allocated, empty counts constructed directly as VecF default has one element
+
+    delta=0.0;
+    offset=0;
+    minBin=0;
+    maxBin=-1;
+    total=0;
+}
+
+
+AreaHistogram::AreaHistogram(double binWidth):counts(0) {
+    //Construct with bin width, window allocated on first area
+
+    delta=binWidth;
+    offset=0;
+    minBin=0;
+    maxBin=-1;
+    total=0;
+}
+
+
+void AreaHistogram::add(double area) {
+    //Add area to histogram
+
+    int b=floor(area/delta);
+    if(b<offset || b>=offset+counts.n) cover(b,b);
+    ++counts[b-offset];
+    if(total==0) minBin=maxBin=b;
+    else if(b<minBin) minBin=b;
+    else if(b>maxBin) maxBin=b;
+    ++total;
+}
+
+
+void AreaHistogram::merge(AreaHistogram &hist) {
+    //Add counts over occupied range of other histogram
+
+    if(hist.total==0) return;
+    cover(hist.minBin,hist.maxBin);
+    for(int b=hist.minBin; b<=hist.maxBin; ++b) counts[b-offset]+=hist.counts[b-hist.offset];
+    if(total==0){
+        minBin=hist.minBin;
+        maxBin=hist.maxBin;
+    }
+    else{
+        if(hist.minBin<minBin) minBin=hist.minBin;
+        if(hist.maxBin>maxBin) maxBin=hist.maxBin;
+    }
+    total+=hist.total;
+}
+
+
+void AreaHistogram::reset() {
+    //Zero counts, window kept as areas of next configurations similar
+
+    counts=0;
+    minBin=0;
+    maxBin=-1;
+    total=0;
+}
+
+
+int AreaHistogram::count(int bin) {
+    //Counts in bin
+
+    if(bin<offset || bin>=offset+counts.n) return 0;
+    return counts[bin-offset];
+}
+
+
+void AreaHistogram::cover(int lo, int hi) {
+    //Extend window to include bins lo to hi, at least doubling so growth amortised
+
+    if(counts.n==0){
+        offset=lo;
+        counts=VecF<int>(hi-lo+1);
+        return;
+    }
+    int newLo=offset, newHi=offset+counts.n-1;
+    if(lo>=newLo && hi<=newHi) return;
+    if(lo<newLo) newLo=min(lo,newLo-counts.n);
+    if(hi>newHi) newHi=max(hi,newHi+counts.n);
+    if(newLo<0) newLo=min(0,lo);
+    VecF<int> window(newHi-newLo+1);
+    for(int i=0; i<counts.n; ++i) window[offset-newLo+i]=counts[i];
+    offset=newLo;
+    counts=window;
+}
@@ -0,0 +1,38 @@
+#ifndef HDMC_AREAHISTOGRAM_H
+#define HDMC_AREAHISTOGRAM_H
+
+#include <iostream>
+#include <cmath>
+#include "vecf.h"
+
+using namespace std;
+
+class AreaHistogram {
+    //Histogram of cell areas with range adapting to observed areas
+    //bins stored in window offset from zero, grown geometrically when area falls outside
+
+public:
+
+    //Data members
+    double delta; //bin width
+    int offset; //bin index of first element of window
+    VecF<int> counts; //counts in window
+    int minBin,maxBin; //smallest and largest occupied bin
+    long total; //total counts
+
+    //Constructors
+    AreaHistogram();
+    AreaHistogram(double binWidth);
+
+    //Member functions
+    void add(double area); //add area to bin, growing range if required
+    void merge(AreaHistogram &hist); //add counts of histogram with same bin width
+    void reset(); //zero counts, keeping window
+    int count(int bin); //counts in bin, zero outside window
+
+private:
+    void cover(int lo, int hi); //grow window to include bins lo to hi
+};
+
+
+#endif //HDMC_AREAHISTOGRAM_H
@@ -0,0 +1,129 @@
+#include "blockaverage.h"
+
+
+BlockAverage::BlockAverage() {
+    //Default constructor
+
+    minBlocks=0;
+}
+
+
+BlockAverage::BlockAverage(int maxLevels, int minBlk) {
+    //Construct with fixed number of levels, covering series up to 2^maxLevels values
+
+    minBlocks=minBlk;
+    count=VecF<long>(maxLevels);
+    mean=VecF<double>(maxLevels);
+    m2=VecF<double>(maxLevels);
+    pending=VecF<double>(maxLevels);
+    hasPending=VecF<bool>(maxLevels);
+}
+
+
+void BlockAverage::add(double value) {
+    //Add value to lowest level, every second block at each level averaged with its partner into next level
+
+    double v=value;
+    for(int k=0; k<count.n; ++k){
+        ++count[k];
+        double d=v-mean[k];
+        mean[k]+=d/count[k];
+        m2[k]+=d*(v-mean[k]);
+        if(!hasPending[k]){
+            pending[k]=v;
+            hasPending[k]=true;
+            return;
+        }
+        v=0.5*(pending[k]+v);
+        hasPending[k]=false;
+    }
+}
+
+
+double BlockAverage::levelError(int level) {
+    //Standard error of mean from variance of blocks at level
+
+    long nb=count[level];
+    if(nb<2) return 0.0;
+    return sqrt(m2[level]/(double(nb)*(nb-1)));
+}
+
+
+int BlockAverage::optimalLevel() {
+    //Smallest block size B=2^k with B^3 > 2N(err_k/err_0)^4 (Lee, Booth and Alavi criterion)
+    //only levels with enough blocks considered
+
+    if(count.n==0 || count[0]<minBlocks) return -1;
+    double err0=levelError(0);
+    if(err0==0.0) return 0; //constant series
+    for(int k=0; k<count.n && count[k]>=minBlocks; ++k){
+        double b=pow(2.0,k);
+        double ratio=levelError(k)/err0;
+        if(b*b*b>2.0*count[0]*pow(ratio,4)) return k;
+    }
+    return -1;
+}
+
+
+double BlockAverage::error() {
+    //Standard error at optimal level, or largest error of levels with enough blocks if not yet converged
+
+    int k=optimalLevel();
+    if(k>=0) return levelError(k);
+    double err=(count.n>0) ? levelError(0) : 0.0;
+    for(int l=1; l<count.n && count[l]>=minBlocks; ++l) err=max(err,levelError(l));
+    return err;
+}
+
+
+double BlockAverage::inefficiency() {
+    //Ratio of blocked to naive variance of mean, approximately twice integrated autocorrelation time
+
+    double err0=(count.n>0) ? levelError(0) : 0.0;
+    if(err0==0.0) return 1.0;
+    return pow(error()/err0,2);
+}
+
+
+double statisticalInefficiency(const double *a, int n) {
+    //Statistical inefficiency g=1+2sum(1-t/n)C(t), autocorrelation summed until first non-positive value after short lag
+
+    if(n<2) return 1.0;
+    double mean=0.0,var=0.0;
+    for(int i=0; i<n; ++i) mean+=a[i];
+    mean/=n;
+    for(int i=0; i<n; ++i) var+=(a[i]-mean)*(a[i]-mean);
+    var/=n;
+    if(var==0.0) return 1.0;
+    double g=1.0;
+    for(int t=1; t<n-1; ++t){
+        double c=0.0;
+        for(int i=0; i<n-t; ++i) c+=(a[i]-mean)*(a[i+t]-mean);
+        c/=(n-t)*var;
+        if(c<=0.0 && t>3) break;
+        g+=2.0*c*(1.0-double(t)/n);
+    }
+    return max(g,1.0);
+}
+
+
+int detectEquilibration(VecR<double> &series, double &g, double &nEff) {
+    //Automated equilibration detection (Chodera 2016), discarding initial values to maximise (n-t0)/g(t0)
+    //candidate starts on grid of at most 50 points
+
+    int nSeries=series.n;
+    int stride=max(1,nSeries/50);
+    int t0=0;
+    g=1.0;
+    nEff=0.0;
+    for(int t=0; t<nSeries-1; t+=stride){
+        double gt=statisticalInefficiency(series.v+t,nSeries-t);
+        double effective=(nSeries-t)/gt;
+        if(effective>nEff){
+            t0=t;
+            g=gt;
+            nEff=effective;
+        }
+    }
+    return t0;
+}
@@ -0,0 +1,41 @@
+#ifndef HDMC_BLOCKAVERAGE_H
+#define HDMC_BLOCKAVERAGE_H
+
+#include <iostream>
+#include <cmath>
+#include "vecf.h"
+#include "vecr.h"
+
+using namespace std;
+
+class BlockAverage {
+    //Streaming Flyvbjerg-Petersen block averaging of scalar series
+    //each level holds running statistics of pairwise averages of level below
+
+public:
+
+    //Data members
+    int minBlocks; //fewest blocks for level to be used
+    VecF<long> count; //blocks at each level
+    VecF<double> mean,m2; //running mean and sum of squared deviations at each level
+    VecF<double> pending; //unpaired block waiting at each level
+    VecF<bool> hasPending; //whether level has unpaired block
+
+    //Constructors
+    BlockAverage();
+    BlockAverage(int maxLevels, int minBlk=16);
+
+    //Member functions
+    void add(double value); //add value to series, propagating completed pairs up levels
+    double levelError(int level); //standard error of mean treating blocks at level as independent
+    int optimalLevel(); //smallest level with converged error, -1 if series too short
+    double error(); //standard error of mean at optimal level or largest usable level
+    double inefficiency(); //statistical inefficiency, ratio of true to naive variance of mean
+};
+
+//Time series statistics
+double statisticalInefficiency(const double *a, int n); //statistical inefficiency from integrated autocorrelation
+int detectEquilibration(VecR<double> &series, double &g, double &nEff); //start of stationary region maximising effective samples
+
+
+#endif //HDMC_BLOCKAVERAGE_H
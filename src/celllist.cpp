@@ -0,0 +1,81 @@
+#include "celllist.h"
+
+
+CellList2D::CellList2D() {
+    //Default constructor
+
+    nc=0;
+    nCells=0;
+}
+
+
+CellList2D::CellList2D(double cellLen, double minCellSize) {
+    //Construct cells no smaller than given size
+    //with fewer than three cells along each side neighbours would be double counted, so use single cell
+
+    len=cellLen;
+    len_2=0.5*len;
+    nc=floor(len/minCellSize);
+    if(nc<3) nc=1;
+    nCells=nc*nc;
+    cellSize=len/nc;
+    cellStart=VecF<int>(nCells+1);
+}
+
+
+void CellList2D::build(VecF<double> &x, VecF<double> &y) {
+    //Assign particles to cells with counting sort, so ordering within cells is by particle id
+
+    int n=x.n;
+    if(atomCell.n!=n){
+        atomCell=VecF<int>(n);
+        cellAtoms=VecF<int>(n);
+    }
+    cellStart=0;
+    for(int i=0; i<n; ++i){
+        int cx=floor((x[i]+len_2)/cellSize);
+        int cy=floor((y[i]+len_2)/cellSize);
+        cx=min(max(cx,0),nc-1);
+        cy=min(max(cy,0),nc-1);
+        atomCell[i]=cy*nc+cx;
+        ++cellStart[atomCell[i]+1];
+    }
+    for(int c=0; c<nCells; ++c) cellStart[c+1]+=cellStart[c];
+    VecF<int> fill(nCells);
+    for(int c=0; c<nCells; ++c) fill[c]=cellStart[c];
+    for(int i=0; i<n; ++i) cellAtoms[fill[atomCell[i]]++]=i;
+}
+
+
+void CellList2D::halfNeighbours(int c, int &nNb, int nb[4]) {
+    //Get the four cells right, above-left, above and above-right of given cell
+
+    nNb=0;
+    if(nc==1) return;
+    int cx=c%nc;
+    int cy=c/nc;
+    int up=((cy+1)%nc)*nc;
+    nb[nNb++]=cy*nc+(cx+1)%nc;
+    nb[nNb++]=up+(cx-1+nc)%nc;
+    nb[nNb++]=up+cx;
+    nb[nNb++]=up+(cx+1)%nc;
+}
+
+
+void CellList2D::halfNeighbours(int c, int &nNb, int nb[4], double sx[4], double sy[4]) {
+    //Get forward neighbours and shifts placing their particles in the image adjacent to given cell
+
+    halfNeighbours(c,nNb,nb);
+    if(nc==1) return;
+    int cx=c%nc;
+    int cy=c/nc;
+    const int ox[4]={1,-1,0,1};
+    const int oy[4]={0,1,1,1};
+    for(int k=0; k<4; ++k){
+        sx[k]=0.0;
+        sy[k]=0.0;
+        if(cx+ox[k]>=nc) sx[k]=len;
+        else if(cx+ox[k]<0) sx[k]=-len;
+        if(cy+oy[k]>=nc) sy[k]=len;
+    }
+}
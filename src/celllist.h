@@ -0,0 +1,33 @@
+#ifndef HDMC_CELLLIST_H
+#define HDMC_CELLLIST_H
+
+#include <iostream>
+#include "vecf.h"
+
+using namespace std;
+
+class CellList2D {
+    //Cell list for square periodic box, particles stored contiguously by cell
+
+public:
+
+    //Data members
+    int nc,nCells; //number of cells along each side and in total
+    double len,len_2; //box length and half
+    double cellSize; //length of each cell
+    VecF<int> cellStart; //start of each cell in cellAtoms, size nCells+1
+    VecF<int> cellAtoms; //particle ids ordered by cell
+    VecF<int> atomCell; //cell of each particle
+
+    //Constructors
+    CellList2D();
+    CellList2D(double cellLen, double minCellSize); //cells at least as large as given size
+
+    //Member functions
+    void build(VecF<double> &x, VecF<double> &y); //assign particles to cells
+    void halfNeighbours(int c, int &nNb, int nb[4]); //forward neighbours of cell, each pair of cells visited once
+    void halfNeighbours(int c, int &nNb, int nb[4], double sx[4], double sy[4]); //forward neighbours with periodic image shifts
+};
+
+
+#endif //HDMC_CELLLIST_H
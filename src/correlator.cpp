@@ -0,0 +1,199 @@
+#include "correlator.h"
+
+
+MultiTauCorrelator::MultiTauCorrelator() {
+    //Default constructor
+
+    n=0;
+    p=0;
+    maxLevels=0;
+    nLevels=0;
+    k=0.0;
+}
+
+
+MultiTauCorrelator::MultiTauCorrelator(int nParticles, double wavevector, int samplesPerLevel, int levels) {
+    //Construct with no levels allocated, buffers allocated as series reaches each level
+
+    if(samplesPerLevel<2 || samplesPerLevel%2!=0) throw string("Correlator samples per level must be even and at least 2");
+    n=nParticles;
+    p=samplesPerLevel;
+    maxLevels=levels;
+    nLevels=0;
+    k=wavevector;
+    bufX=VecF< VecF<double> >(maxLevels*p);
+    bufY=VecF< VecF<double> >(maxLevels*p);
+    head=VecF<int>(maxLevels);
+    filled=VecF<int>(maxLevels);
+    arrivals=VecF<long>(maxLevels);
+    msdSum=VecF<double>(maxLevels*p);
+    fsSum=VecF<double>(maxLevels*p);
+    lagCount=VecF<long>(maxLevels*p);
+}
+
+
+void MultiTauCorrelator::add(VecF<double> &x, VecF<double> &y) {
+    //Add sample to lowest level
+
+    push(0,x.v,y.v);
+}
+
+
+void MultiTauCorrelator::push(int level, const double *x, const double *y) {
+    //Store sample in ring buffer of level, correlate with earlier samples and pass every second sample up
+    //lowest level correlates all lags, higher levels only lags not already covered by level below
+
+    if(level>=maxLevels) return;
+    if(level==nLevels){
+        for(int j=0; j<p; ++j){
+            bufX[level*p+j]=VecF<double>(n);
+            bufY[level*p+j]=VecF<double>(n);
+        }
+        ++nLevels;
+    }
+    head[level]=(head[level]+1)%p;
+    double *hx=bufX[level*p+head[level]].v;
+    double *hy=bufY[level*p+head[level]].v;
+    for(int i=0; i<n; ++i){
+        hx[i]=x[i];
+        hy[i]=y[i];
+    }
+    if(filled[level]<p) ++filled[level];
+    ++arrivals[level];
+
+    int jMin=(level==0) ? 1 : p/2;
+    for(int j=jMin; j<filled[level]; ++j){
+        int s=(head[level]-j+p)%p;
+        const double *ox=bufX[level*p+s].v;
+        const double *oy=bufY[level*p+s].v;
+        double sumSq=0.0,sumCos=0.0;
+        for(int i=0; i<n; ++i){
+            double dx=x[i]-ox[i];
+            double dy=y[i]-oy[i];
+            sumSq+=dx*dx+dy*dy;
+            sumCos+=cos(k*dx)+cos(k*dy);
+        }
+        msdSum[level*p+j]+=sumSq/n;
+        fsSum[level*p+j]+=sumCos/(2*n);
+        ++lagCount[level*p+j];
+    }
+
+    if(arrivals[level]%2==0) push(level+1,x,y);
+}
+
+
+int MultiTauCorrelator::lags(VecF<long> &lag, VecF<double> &msd, VecF<double> &fs) {
+    //Lag in samples and origin averaged correlations in increasing lag, returns number of lags
+
+    int nLags=0;
+    for(int i=0; i<nLevels*p; ++i) if(lagCount[i]>0) ++nLags;
+    lag=VecF<long>(nLags);
+    msd=VecF<double>(nLags);
+    fs=VecF<double>(nLags);
+    int m=0;
+    for(int l=0; l<nLevels; ++l){
+        for(int j=0; j<p; ++j){
+            int b=l*p+j;
+            if(lagCount[b]==0) continue;
+            lag[m]=long(j)<<l;
+            msd[m]=msdSum[b]/lagCount[b];
+            fs[m]=fsSum[b]/lagCount[b];
+            ++m;
+        }
+    }
+    return nLags;
+}
+
+
+OverlapCorrelator::OverlapCorrelator() {
+    //Default constructor
+
+    n=0;
+    probeSq=0.0;
+    nRefs=0;
+    refInterval=1;
+    time=0;
+}
+
+
+OverlapCorrelator::OverlapCorrelator(int nParticles, double probe, int refs, int interval) {
+    //Construct with empty ring buffer and lags spaced approximately ten per decade
+
+    if(refs<1 || interval<1) throw string("Overlap correlator needs at least one reference and positive interval");
+    n=nParticles;
+    probeSq=probe*probe;
+    nRefs=refs;
+    refInterval=interval;
+    time=0;
+    long maxLag=long(nRefs)*refInterval;
+    VecR<long> lagList(0,200);
+    for(long l=1; l<=maxLag; l=max(l+1,long(round(l*pow(10.0,0.1))))) lagList.addValue(l);
+    lags=VecF<long>(lagList.n);
+    for(int i=0; i<lags.n; ++i) lags[i]=lagList[i];
+    refX=VecF< VecF<double> >(nRefs);
+    refY=VecF< VecF<double> >(nRefs);
+    for(int j=0; j<nRefs; ++j){
+        refX[j]=VecF<double>(n);
+        refY[j]=VecF<double>(n);
+    }
+    refTime=VecF<long>(nRefs);
+    refTime=-1;
+    refNext=VecF<int>(nRefs);
+    qSum=VecF<double>(lags.n);
+    q2Sum=VecF<double>(lags.n);
+    qCount=VecF<long>(lags.n);
+}
+
+
+void OverlapCorrelator::add(VecF<double> &x, VecF<double> &y) {
+    //Correlate held references reaching their next lag, then replace oldest reference if due
+    //overlap counted branch-free over contiguous particle arrays
+
+    for(int j=0; j<nRefs; ++j){
+        if(refTime[j]<0 || refNext[j]>=lags.n || time-refTime[j]!=lags[refNext[j]]) continue;
+        const double *ox=refX[j].v;
+        const double *oy=refY[j].v;
+        int overlap=0;
+        for(int i=0; i<n; ++i){
+            double dx=x.v[i]-ox[i];
+            double dy=y.v[i]-oy[i];
+            overlap+=(dx*dx+dy*dy<probeSq);
+        }
+        double q=double(overlap)/n;
+        int b=refNext[j]++;
+        qSum[b]+=q;
+        q2Sum[b]+=q*q;
+        ++qCount[b];
+    }
+    if(time%refInterval==0){
+        int j=(time/refInterval)%nRefs;
+        for(int i=0; i<n; ++i){
+            refX[j][i]=x[i];
+            refY[j][i]=y[i];
+        }
+        refTime[j]=time;
+        refNext[j]=0;
+    }
+    ++time;
+}
+
+
+int OverlapCorrelator::results(VecF<long> &lag, VecF<double> &q, VecF<double> &chi4) {
+    //Mean overlap and four-point susceptibility n(<q^2>-<q>^2) in increasing lag, returns number of lags
+
+    int nLags=0;
+    for(int i=0; i<lags.n; ++i) if(qCount[i]>0) ++nLags;
+    lag=VecF<long>(nLags);
+    q=VecF<double>(nLags);
+    chi4=VecF<double>(nLags);
+    int m=0;
+    for(int i=0; i<lags.n; ++i){
+        if(qCount[i]==0) continue;
+        double mean=qSum[i]/qCount[i];
+        lag[m]=lags[i];
+        q[m]=mean;
+        chi4[m]=n*(q2Sum[i]/qCount[i]-mean*mean);
+        ++m;
+    }
+    return nLags;
+}
@@ -0,0 +1,71 @@
+#ifndef HDMC_CORRELATOR_H
+#define HDMC_CORRELATOR_H
+
+#include <iostream>
+#include <cmath>
+#include "vecf.h"
+#include "vecr.h"
+
+using namespace std;
+
+class MultiTauCorrelator {
+    //Streaming multi-tau correlator of particle displacements, mean squared displacement and self intermediate scattering
+    //level l holds last p samples spaced 2^l apart, every second sample passed up, so memory grows with log of series length
+    //samples decimated rather than averaged at coarser levels as displacement correlations non-linear in position
+
+public:
+
+    //Data members
+    int n; //number of particles
+    int p; //samples per level
+    int maxLevels; //levels available, longest lag p*2^(maxLevels-1)
+    int nLevels; //levels allocated
+    double k; //wavevector magnitude
+    VecF< VecF<double> > bufX,bufY; //ring buffer of unwrapped positions at each level
+    VecF<int> head,filled; //most recent slot and number of samples held at each level
+    VecF<long> arrivals; //samples received at each level
+    VecF<double> msdSum,fsSum; //sum over origins of particle averaged correlations at each level and lag
+    VecF<long> lagCount; //origins contributing at each level and lag
+
+    //Constructors
+    MultiTauCorrelator();
+    MultiTauCorrelator(int nParticles, double wavevector, int samplesPerLevel=16, int levels=32);
+
+    //Member functions
+    void add(VecF<double> &x, VecF<double> &y); //add unwrapped positions as next sample
+    int lags(VecF<long> &lag, VecF<double> &msd, VecF<double> &fs); //correlations at each lag with at least one origin
+
+private:
+    void push(int level, const double *x, const double *y); //add sample to level and correlate with held samples
+};
+
+class OverlapCorrelator {
+    //Streaming overlap function and four-point susceptibility from bounded ring buffer of reference configurations
+    //reference taken every interval samples, each correlated at log-spaced lags until overwritten a full ring later
+
+public:
+
+    //Data members
+    int n; //number of particles
+    double probeSq; //squared probe length within which particle overlaps its reference position
+    int nRefs; //reference configurations held
+    int refInterval; //samples between references
+    long time; //samples received
+    VecF<long> lags; //log-spaced lags up to longest lag nRefs*refInterval
+    VecF< VecF<double> > refX,refY; //ring buffer of reference unwrapped positions
+    VecF<long> refTime; //time of each reference, -1 if empty
+    VecF<int> refNext; //index of next lag of each reference
+    VecF<double> qSum,q2Sum; //sum over references of overlap and its square at each lag
+    VecF<long> qCount; //references contributing at each lag
+
+    //Constructors
+    OverlapCorrelator();
+    OverlapCorrelator(int nParticles, double probe, int refs, int interval);
+
+    //Member functions
+    void add(VecF<double> &x, VecF<double> &y); //add unwrapped positions as next sample
+    int results(VecF<long> &lag, VecF<double> &q, VecF<double> &chi4); //mean overlap and susceptibility at each lag with at least one reference
+};
+
+
+#endif //HDMC_CORRELATOR_H
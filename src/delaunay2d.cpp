@@ -0,0 +1,349 @@
+#include "delaunay2d.h"
+
+
+static uint64_t hilbertIndex(uint32_t x, uint32_t y, uint32_t side) {
+    //Position along Hilbert curve filling square grid
+    uint64_t d=0;
+    for(uint32_t s=side/2; s>0; s/=2){
+        uint32_t rx=(x&s)>0;
+        uint32_t ry=(y&s)>0;
+        d+=uint64_t(s)*s*((3*rx)^ry);
+        if(ry==0){
+            if(rx==1){
+                x=side-1-x;
+                y=side-1-y;
+            }
+            swap(x,y);
+        }
+    }
+    return d;
+}
+
+
+Delaunay2D::Delaunay2D() {
+    //Default constructor
+
+    n=0;
+    len=0.0;
+}
+
+
+Delaunay2D::Delaunay2D(double cellLen) {
+    //Construct for square periodic box
+
+    n=0;
+    len=cellLen;
+    walkSeed=12345;
+}
+
+
+void Delaunay2D::tessellate(VecF<double> &x, VecF<double> &y, VecF<double> &w, int maxV) {
+    //Triangulate particles and images, widening halo until all cells are unaffected by its edge
+
+    n=x.n;
+    double wMax=0.0;
+    for(int i=0; i<n; ++i) wMax=max(wMax,w[i]);
+    double margin=4.0*len/sqrt(double(n))+sqrt(wMax);
+    for(;;){
+        extend(x,y,w,margin);
+        triangulate();
+        if(extract(maxV,wMax)) break;
+        margin*=1.5;
+    }
+}
+
+
+void Delaunay2D::extend(VecF<double> &x, VecF<double> &y, VecF<double> &w, double margin) {
+    //Add particles then all periodic images within margin of box, then bounding triangle
+
+    box=0.5*len+margin;
+    px.clear();
+    py.clear();
+    pw.clear();
+    image.clear();
+    imageSx.clear();
+    imageSy.clear();
+    for(int i=0; i<n; ++i){
+        px.push_back(x[i]);
+        py.push_back(y[i]);
+        pw.push_back(w[i]);
+        image.push_back(i);
+        imageSx.push_back(0);
+        imageSy.push_back(0);
+    }
+    int k=ceil(margin/len);
+    for(int sy=-k; sy<=k; ++sy){
+        for(int sx=-k; sx<=k; ++sx){
+            if(sx==0 && sy==0) continue;
+            for(int i=0; i<n; ++i){
+                double xi=x[i]+sx*len;
+                double yi=y[i]+sy*len;
+                if(fabs(xi)<=box && fabs(yi)<=box){
+                    px.push_back(xi);
+                    py.push_back(yi);
+                    pw.push_back(w[i]);
+                    image.push_back(i);
+                    imageSx.push_back(sx);
+                    imageSy.push_back(sy);
+                }
+            }
+        }
+    }
+    nPts=px.size();
+
+    //Bounding triangle well outside extended region
+    double far=20.0*box;
+    px.push_back(-far);
+    py.push_back(-0.5*far);
+    px.push_back(far);
+    py.push_back(-0.5*far);
+    px.push_back(0.0);
+    py.push_back(far);
+    for(int i=0; i<3; ++i){
+        pw.push_back(0.0);
+        image.push_back(-1);
+        imageSx.push_back(0);
+        imageSy.push_back(0);
+    }
+}
+
+
+void Delaunay2D::triangulate() {
+    //Insert points in Hilbert curve order so each walk starts near its target
+
+    triV.clear();
+    triNb.clear();
+    triAlive.clear();
+    triMark.clear();
+    freeTri.clear();
+    triV.reserve(6*nPts+6);
+    triNb.reserve(6*nPts+6);
+    vertTri.assign(nPts+3,-1);
+    edgeStart.assign(nPts+3,-1);
+    edgeEnd.assign(nPts+3,-1);
+    stamp=0;
+    int start=newTriangle(nPts,nPts+1,nPts+2);
+    for(int i=0; i<3; ++i) vertTri[nPts+i]=start;
+
+    const uint32_t side=1<<16;
+    double scale=(side-1)/(2.0*box);
+    vector< pair<uint64_t,int> > order(nPts);
+    for(int i=0; i<nPts; ++i){
+        uint32_t gx=(px[i]+box)*scale;
+        uint32_t gy=(py[i]+box)*scale;
+        order[i]=make_pair(hilbertIndex(gx,gy,side),i);
+    }
+    sort(order.begin(),order.end());
+    for(int i=0; i<nPts; ++i) insert(order[i].second,start);
+}
+
+
+void Delaunay2D::insert(int p, int &start) {
+    //Remove triangles whose orthocircle conflicts with point and join point to cavity boundary
+    //points in conflict with no triangle are hidden by their neighbours' weights and left out
+
+    int t0=locate(p,start);
+    if(power(t0,p)<=0) return;
+
+    //Grow cavity through conflicting neighbours, recording boundary edges and position in outer triangle
+    stamp+=2;
+    int inMark=stamp,outMark=stamp+1;
+    cavity.assign(1,t0);
+    bndA.clear();
+    bndB.clear();
+    bndOut.clear();
+    bndIdx.clear();
+    triMark[t0]=inMark;
+    for(int c=0; c<int(cavity.size()); ++c){
+        int t=cavity[c];
+        for(int i=0; i<3; ++i){
+            int u=triNb[3*t+i];
+            if(u>=0){
+                if(triMark[u]==inMark) continue;
+                if(triMark[u]!=outMark){
+                    if(power(u,p)>0){
+                        triMark[u]=inMark;
+                        cavity.push_back(u);
+                        continue;
+                    }
+                    triMark[u]=outMark;
+                }
+            }
+            bndA.push_back(triV[3*t+(i+1)%3]);
+            bndB.push_back(triV[3*t+(i+2)%3]);
+            bndOut.push_back(u);
+            int j=-1;
+            if(u>=0) for(j=0; j<3; ++j) if(triNb[3*u+j]==t) break;
+            bndIdx.push_back(j);
+        }
+    }
+    for(int c=0; c<int(cavity.size()); ++c){
+        triAlive[cavity[c]]=false;
+        freeTri.push_back(cavity[c]);
+    }
+
+    //Fan of new triangles, linked to outer triangles then to each other
+    fan.resize(bndA.size());
+    for(int e=0; e<int(bndA.size()); ++e){
+        int a=bndA[e],b=bndB[e];
+        int k=newTriangle(p,a,b);
+        triNb[3*k]=bndOut[e];
+        if(bndOut[e]>=0) triNb[3*bndOut[e]+bndIdx[e]]=k;
+        edgeStart[a]=k;
+        edgeEnd[b]=k;
+        vertTri[a]=k;
+        vertTri[b]=k;
+        fan[e]=k;
+    }
+    for(int e=0; e<int(fan.size()); ++e){
+        int k=fan[e];
+        triNb[3*k+1]=edgeStart[triV[3*k+2]];
+        triNb[3*k+2]=edgeEnd[triV[3*k+1]];
+    }
+    vertTri[p]=fan[0];
+    start=fan[0];
+}
+
+
+int Delaunay2D::locate(int p, int start) {
+    //Visibility walk, crossing any edge with point strictly beyond it, starting edge varied to avoid cycling
+
+    int t=start;
+    for(;;){
+        walkSeed=walkSeed*1103515245u+12345u;
+        int r=(walkSeed>>16)%3;
+        bool moved=false;
+        for(int e=0; e<3; ++e){
+            int i=(r+e)%3;
+            int a=triV[3*t+(i+1)%3];
+            int b=triV[3*t+(i+2)%3];
+            if(orient(a,b,p)<0){
+                t=triNb[3*t+i];
+                moved=true;
+                break;
+            }
+        }
+        if(!moved) return t;
+    }
+}
+
+
+int Delaunay2D::newTriangle(int a, int b, int c) {
+    //Create triangle from anticlockwise vertices, reusing free slots
+
+    int t;
+    if(freeTri.size()>0){
+        t=freeTri.back();
+        freeTri.pop_back();
+        triAlive[t]=true;
+    }
+    else{
+        t=triAlive.size();
+        triV.resize(3*t+3);
+        triNb.resize(3*t+3);
+        triAlive.push_back(true);
+        triMark.push_back(0);
+    }
+    triV[3*t]=a;
+    triV[3*t+1]=b;
+    triV[3*t+2]=c;
+    for(int i=0; i<3; ++i) triNb[3*t+i]=-1;
+    return t;
+}
+
+
+int Delaunay2D::orient(int a, int b, int c) {
+    //Positive if anticlockwise
+
+    return orient2D(px[a],py[a],px[b],py[b],px[c],py[c]);
+}
+
+
+int Delaunay2D::power(int t, int d) {
+    //Positive if point lies within orthocircle of triangle
+
+    const int *v=&triV[3*t];
+    double qx[4]={px[v[0]],px[v[1]],px[v[2]],px[d]};
+    double qy[4]={py[v[0]],py[v[1]],py[v[2]],py[d]};
+    double qw[4]={pw[v[0]],pw[v[1]],pw[v[2]],pw[d]};
+    return powerTest(qx,qy,qw);
+}
+
+
+bool Delaunay2D::extract(int maxV, double wMax) {
+    //Cell vertices are orthocentres of triangles round each particle, walked anticlockwise
+    //a triangle is exact if no point outside extended region can lie within its orthocircle
+
+    //Orthocentres of triangles touching particles, relative to first vertex
+    int nTri=triAlive.size();
+    triOx.resize(nTri);
+    triOy.resize(nTri);
+    for(int t=0; t<nTri; ++t){
+        if(!triAlive[t]) continue;
+        const int *v=&triV[3*t];
+        if(v[0]>=n && v[1]>=n && v[2]>=n) continue;
+        if(v[0]>=nPts || v[1]>=nPts || v[2]>=nPts) return false;
+        double bx=px[v[1]]-px[v[0]],by=py[v[1]]-py[v[0]];
+        double cx=px[v[2]]-px[v[0]],cy=py[v[2]]-py[v[0]];
+        double bb=bx*bx+by*by-pw[v[1]]+pw[v[0]];
+        double cc=cx*cx+cy*cy-pw[v[2]]+pw[v[0]];
+        double rD=0.5/(bx*cy-by*cx);
+        double ox=(bb*cy-cc*by)*rD;
+        double oy=(bx*cc-cx*bb)*rD;
+        double rSq=ox*ox+oy*oy-pw[v[0]];
+        double edge=box-max(fabs(px[v[0]]+ox),fabs(py[v[0]]+oy));
+        if(edge<=0.0 || edge*edge<=rSq+wMax) return false;
+        triOx[t]=ox;
+        triOy[t]=oy;
+    }
+
+    cellStart.assign(n+1,0);
+    cellNbs.clear();
+    cellNbSx.clear();
+    cellNbSy.clear();
+    cellEdges.clear();
+    cellVx.clear();
+    cellVy.clear();
+    cellAreas.assign(n,0.0);
+    for(int i=0; i<n; ++i){
+        //Hidden particles have no triangles
+        cellStart[i]=cellNbs.size();
+        int t=vertTri[i];
+        if(t<0 || !triAlive[t]) continue;
+        int li=0;
+        while(li<3 && triV[3*t+li]!=i) ++li;
+        if(li==3) continue;
+
+        //Neighbours and orthocentres relative to particle
+        zx.clear();
+        zy.clear();
+        int t0=t;
+        do{
+            int v0=triV[3*t];
+            int nb=triV[3*t+(li+2)%3];
+            cellNbs.push_back(image[nb]);
+            cellNbSx.push_back(imageSx[nb]);
+            cellNbSy.push_back(imageSy[nb]);
+            zx.push_back((px[v0]-px[i])+triOx[t]);
+            zy.push_back((py[v0]-py[i])+triOy[t]);
+            t=triNb[3*t+(li+1)%3];
+            li=0;
+            while(triV[3*t+li]!=i) ++li;
+        } while(t!=t0);
+        if(int(zx.size())>maxV) throw string("Native Voronoi cell exceeds maximum vertices");
+
+        //Shared edge lengths, vertices and area by shoelace
+        int nv=zx.size();
+        double area=0.0;
+        for(int k=0; k<nv; ++k){
+            int k1=(k+1)%nv;
+            cellEdges.push_back(sqrt((zx[k1]-zx[k])*(zx[k1]-zx[k])+(zy[k1]-zy[k])*(zy[k1]-zy[k])));
+            cellVx.push_back(px[i]+zx[k]);
+            cellVy.push_back(py[i]+zy[k]);
+            area+=zx[k]*zy[k1]-zx[k1]*zy[k];
+        }
+        cellAreas[i]=0.5*area;
+    }
+    cellStart[n]=cellNbs.size();
+    return true;
+}
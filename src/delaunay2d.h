@@ -0,0 +1,70 @@
+#ifndef HDMC_DELAUNAY2D_H
+#define HDMC_DELAUNAY2D_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "vecf.h"
+#include "predicates.h"
+
+using namespace std;
+
+class Delaunay2D {
+    //Periodic 2D regular (weighted Delaunay) triangulation and dual power diagram
+    //Periodicity handled by triangulating particles with a halo of images, widened until every cell is exact
+
+private:
+
+    //Data members
+    int nPts; //number of points in extended set, excluding bounding triangle
+    double box; //half width of extended region
+    vector<double> px,py,pw; //extended point coordinates and weights, bounding triangle last
+    vector<int> image; //original particle of each point
+    vector<int> imageSx,imageSy; //periodic image of each point in box lengths
+    vector<int> triV,triNb; //triangle vertices anticlockwise and neighbour opposite each vertex
+    vector<char> triAlive; //triangle in use
+    vector<int> freeTri; //unused triangle slots
+    vector<int> vertTri; //a triangle containing each vertex
+    vector<int> triMark; //triangle stamp during cavity search
+    vector<double> triOx,triOy; //triangle orthocentre relative to first vertex
+    vector<double> zx,zy; //cell vertices relative to particle during extraction
+    vector<int> edgeStart,edgeEnd; //new triangle starting and ending with each vertex during insertion
+    vector<int> cavity,fan; //triangles removed and added by insertion
+    vector<int> bndA,bndB,bndOut,bndIdx; //cavity boundary edges, outer triangle and its index for shared edge
+    int stamp; //current cavity stamp
+    unsigned int walkSeed; //generator for walk start edge
+
+    //Member functions
+    void extend(VecF<double> &x, VecF<double> &y, VecF<double> &w, double margin); //particles and images in halo
+    void triangulate(); //insert points in spatial order
+    void insert(int p, int &start); //insert single point by Bowyer-Watson
+    int locate(int p, int start); //walk to triangle containing point
+    int newTriangle(int a, int b, int c);
+    int orient(int a, int b, int c); //sign of orientation of three points
+    int power(int t, int d); //sign of power test of point against triangle
+    bool extract(int maxV, double wMax); //build cells of original particles, false if halo too narrow
+
+public:
+
+    //Data members
+    int n; //number of particles
+    double len; //periodic box length
+    vector<int> cellStart; //start of each particle's cell in flat arrays, size n+1, empty if hidden
+    vector<int> cellNbs; //neighbours of each particle anticlockwise
+    vector<int> cellNbSx,cellNbSy; //periodic image of each neighbour adjacent to particle, in box lengths
+    vector<double> cellEdges; //length of cell edge shared with each neighbour
+    vector<double> cellVx,cellVy; //cell vertices anticlockwise, in image adjacent to particle
+    vector<double> cellAreas; //area of each cell
+
+    //Constructors
+    Delaunay2D();
+    Delaunay2D(double cellLen);
+
+    //Member functions
+    void tessellate(VecF<double> &x, VecF<double> &y, VecF<double> &w, int maxV); //power diagram with weights as squared radii
+};
+
+
+#endif //HDMC_DELAUNAY2D_H
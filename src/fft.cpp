@@ -0,0 +1,66 @@
+#include "fft.h"
+
+
+FFT2D::FFT2D() {
+    //Default constructor
+
+    m=0;
+    logM=0;
+}
+
+
+FFT2D::FFT2D(int size) {
+    //Precompute twiddle factors and bit reversal for given size
+
+    m=size;
+    logM=0;
+    while((1<<logM)<m) ++logM;
+    if((1<<logM)!=m) throw string("FFT size must be power of two");
+    twiddle=VecF< complex<double> >(max(m/2,1));
+    for(int k=0; k<m/2; ++k) twiddle[k]=polar(1.0,-2.0*M_PI*k/m);
+    bitRev=VecF<int>(m);
+    for(int i=0; i<m; ++i){
+        int j=0;
+        for(int b=0; b<logM; ++b) if(i&(1<<b)) j|=1<<(logM-1-b);
+        bitRev[i]=j;
+    }
+}
+
+
+void FFT2D::transform1D(complex<double> *data) {
+    //Iterative Cooley-Tukey transform
+
+    const int *rev=bitRev.v;
+    const complex<double> *w=twiddle.v;
+    for(int i=0; i<m; ++i){
+        if(i<rev[i]) swap(data[i],data[rev[i]]);
+    }
+    for(int len=2; len<=m; len<<=1){
+        int half=len/2;
+        int step=m/len;
+        for(int i=0; i<m; i+=len){
+            for(int k=0; k<half; ++k){
+                complex<double> t=w[k*step]*data[i+k+half];
+                data[i+k+half]=data[i+k]-t;
+                data[i+k]+=t;
+            }
+        }
+    }
+}
+
+
+void FFT2D::transform(VecF< complex<double> > &grid, int nThreads) {
+    //Transform rows then columns, columns copied to contiguous buffer
+
+    parallelFor(nThreads,0,m,[&](int r0, int r1, int t){
+        for(int r=r0; r<r1; ++r) transform1D(grid.v+r*m);
+    });
+    parallelFor(nThreads,0,m,[&](int c0, int c1, int t){
+        VecF< complex<double> > column(m);
+        for(int c=c0; c<c1; ++c){
+            for(int r=0; r<m; ++r) column[r]=grid.v[r*m+c];
+            transform1D(column.v);
+            for(int r=0; r<m; ++r) grid.v[r*m+c]=column[r];
+        }
+    });
+}
@@ -0,0 +1,37 @@
+//Fast Fourier Transform
+#ifndef NL_FFT_H
+#define NL_FFT_H
+
+#include <iostream>
+#include <complex>
+#include <cmath>
+#include "vecf.h"
+#include "parallel.h"
+
+using namespace std;
+
+class FFT2D {
+    //Radix-2 complex FFT on square grid of power of two size, stored row major
+
+private:
+
+    //Data members
+    int m,logM; //points along each side and log2
+    VecF< complex<double> > twiddle; //roots of unity exp(-2 pi i k/m)
+    VecF<int> bitRev; //bit reversal permutation
+
+    //Member functions
+    void transform1D(complex<double> *data); //in place transform of contiguous sequence
+
+public:
+
+    //Constructors
+    FFT2D();
+    FFT2D(int size);
+
+    //Member functions
+    void transform(VecF< complex<double> > &grid, int nThreads=1); //in place forward transform of grid
+};
+
+
+#endif //NL_FFT_H
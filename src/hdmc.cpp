@@ -13,6 +13,11 @@ HDMC::HDMC() {
     nA=0;
     nB=0;
     phi=0;
+    nThreads=1;
+    initAttempts=1;
+    initCancel=nullptr;
+    analysisWorkers=0;
+    taskThreads=1;
 }
 
 
@@ -45,6 +50,7 @@ int HDMC::setParticles(int num, double packFrac, int disp, VecF<double> dispPara
 int HDMC::setRandom(int seed) {
     //Set random seed and generators
 
+    randomSeed=seed;
     mtGen.seed(seed);
     randParticle=uniform_int_distribution<int>(0,n-1);
     rand01=uniform_real_distribution<double>(0,1);
@@ -53,10 +59,11 @@ int HDMC::setRandom(int seed) {
 }
 
 
-int HDMC::setSimulation(int eq, int prod, double swap, double accTarg) {
+int HDMC::setSimulation(int eq, int prod, double swap, double accTarg, int eqDet) {
     //Set simulation parameters
 
     eqCycles=eq;
+    eqDetect=(eqDet==1);
     prodCycles=prod;
     swapProb=swap;
     transProb=1.0-swapProb;
@@ -67,13 +74,35 @@ int HDMC::setSimulation(int eq, int prod, double swap, double accTarg) {
 }
 
 
-int HDMC::setAnalysis(string path, int anFreq, int rdf, double rdfDel, int adf, double adfDel, VecF<int> vor, double radZ, int visF, int vis3) {
+int HDMC::setParallel(int threads, int attempts, int workers) {
+    //Set parallelisation parameters
+
+    nThreads=threads;
+    if(nThreads<1) nThreads=1;
+    initAttempts=attempts;
+    if(initAttempts<1) initAttempts=1;
+    analysisWorkers=workers;
+    if(analysisWorkers<0) analysisWorkers=0;
+
+    return 0;
+}
+
+
+int HDMC::setAnalysis(string path, int anFreq, int rdf, double rdfDel, double rdfMaximum, int rdfCls, int skGridPoints, int adf, double adfDel, VecF<int> vor, double radZ, int vorEng, int psi6, int t1, int block, VecF<double> blockTarg, int dyn, double dynK, int chi4, double chi4A, int chi4R, int visF, int vis3) {
     //Set analysis parameters
 
     outputPrefix=path;
     analysisFreq=anFreq;
 
     //Set rdf type
+    rdfDelta=rdfDel;
+    rdfMax=rdfMaximum;
+    rdfClasses=rdfCls;
+
+    //Set structure factor grid, rounded up to power of two
+    skCalc=(skGridPoints>0);
+    skGrid=1;
+    while(skGrid<skGridPoints) skGrid*=2;
     if(rdf==0) rdfCalc=false;
     else if(rdf==1){
         rdfCalc=true;
@@ -128,6 +157,26 @@ int HDMC::setAnalysis(string path, int anFreq, int rdf, double rdfDel, int adf,
     if(vor[3]==1) radCalc3D=true;
     radCut=radZ;
     maxVertices=40;
+    vorNative=(vorEng==1);
+
+    //Set bond orientational order, reuses 2D Voronoi neighbours
+    psi6Calc=(psi6==1 && vorCalc2D);
+
+    //Set T1 event tracking, topology only maintained during production
+    t1Calc=(t1==1);
+    topologyActive=false;
+
+    //Set block averaging and production stopping targets
+    blockCalc=(block==1);
+    blockTargets=blockTarg;
+
+    //Set displacement correlations, unwrapped positions only maintained during production
+    dynCalc=(dyn==1);
+    dynWavevector=dynK;
+    chi4Calc=(chi4==1);
+    chi4Probe=chi4A;
+    chi4Refs=max(1,chi4R);
+    unwrapActive=false;
 
     return 0;
 }
@@ -139,10 +188,52 @@ int HDMC::initAnalysis() {
     analysisConfigs=0;
     xyzConfigs=0;
 
+    //Pair correlation cutoff rounded up to whole number of bins, max distance is half cell size
+    int rdfBins=ceil(rdfMax/rdfDelta);
+    rdfMax=rdfBins*rdfDelta;
+    if(rdfMax<=0.0 || rdfMax>cellLen_2){
+        rdfMax=cellLen_2;
+        rdfBins=floor(rdfMax/rdfDelta)+1;
+    }
+
     //RDF histogram
     if(rdfCalc){
-        int maxBin=floor(cellLen_2/rdfDelta)+1; //max distance is half cell size
+        int maxBin=rdfBins;
         rdfHist=VecF<int>(maxBin);
+        rdfCells=CellList2D(cellLen,rdfMax);
+        //Species of each particle and histogram block for each species pair
+        rdfSpecies=VecF<int>(n);
+        if(dispersity==2){
+            for(int i=nA; i<n; ++i) rdfSpecies[i]=1;
+            rdfPairBlocks=VecF<int>(4);
+            rdfPairBlocks[1]=1; //AB
+            rdfPairBlocks[2]=1; //BA
+            rdfPairBlocks[3]=2; //BB
+        }
+        else if(dispersity==3 && rdfClasses>1){//polydisperse radius classes of equal population
+            VecF<int> sort=vArgSort(r);
+            rdfClassEdges=VecF<double>(rdfClasses+1);
+            rdfClassCounts=VecF<int>(rdfClasses);
+            for(int k=0; k<n; ++k){
+                int c=(long(k)*rdfClasses)/n;
+                rdfSpecies[sort[k]]=c;
+                ++rdfClassCounts[c];
+                if(rdfClassCounts[c]==1) rdfClassEdges[c]=r[sort[k]];
+            }
+            rdfClassEdges[rdfClasses]=r[sort[n-1]];
+            //Block for each unordered class pair
+            rdfPairBlocks=VecF<int>(rdfClasses*rdfClasses);
+            int block=0;
+            for(int a=0; a<rdfClasses; ++a){
+                for(int b=a; b<rdfClasses; ++b){
+                    rdfPairBlocks[a*rdfClasses+b]=block;
+                    rdfPairBlocks[b*rdfClasses+a]=block;
+                    ++block;
+                }
+            }
+            rdfClassHist=VecF<int>(block*maxBin);
+        }
+        else rdfPairBlocks=VecF<int>(1);
         if(dispersity==2){//bidisperse calculate partial rdfs
             prdfHistAA=VecF<int>(maxBin);
             prdfHistAB=VecF<int>(maxBin);
@@ -150,14 +241,43 @@ int HDMC::initAnalysis() {
         }
     }
 
+    //Bond orientational order time series and g6 histograms sharing rdf cutoff and bin width
+    if(psi6Calc){
+        psi6Series=VecR<double>(0,2*(prodCycles/analysisFreq+1));
+        g6Cells=CellList2D(cellLen,rdfMax);
+        g6Count=VecF<long>(rdfBins);
+        g6Sum=VecF<double>(rdfBins);
+        g6SumW=VecF<double>(rdfBins);
+    }
+
+    //T1 event time series and periodic triangulation
+    if(t1Calc){
+        t1Series=VecR<long>(0,prodCycles/analysisFreq+1);
+        topology=TorusDelaunay2D(cellLen);
+    }
+
+    //Structure factor grid and accumulators, output to half Nyquist where assignment aliasing is small
+    if(skCalc){
+        skFFT=FFT2D(skGrid);
+        skDensity=VecF< complex<double> >(skGrid*skGrid);
+        int maxBin=skGrid/4+1;
+        skK=VecF<double>(maxBin);
+        skS=VecF<double>(maxBin);
+        skCount=VecF<int>(maxBin);
+        if(dispersity==2){
+            skSAA=VecF<double>(maxBin);
+            skSAB=VecF<double>(maxBin);
+            skSBB=VecF<double>(maxBin);
+        }
+    }
+
     //ADF histogram
     if(adfCalc){
         adfDelta*=n;
-        int maxBin=floor(cellLen*cellLen/adfDelta)+1;
-        adfHistVor2D=VecF<int>(maxBin);
-        adfHistRad2D=VecF<int>(maxBin);
-        adfHistVor3D=VecF<int>(maxBin);
-        adfHistRad3D=VecF<int>(maxBin);
+        if(vorCalc2D) adfHistVor2D=AreaHistogram(adfDelta);
+        if(radCalc2D) adfHistRad2D=AreaHistogram(adfDelta);
+        if(vorCalc3D) adfHistVor3D=AreaHistogram(adfDelta);
+        if(radCalc3D) adfHistRad3D=AreaHistogram(adfDelta);
     }
 
     //Voronoi distributions
@@ -201,15 +321,166 @@ int HDMC::initAnalysis() {
         rad3DNNCount=VecF<int>(3);
         rad3DNNSep=VecF<double>(3);
     }
+    //Block averages of acceptance, network assortativity, hexagon area and rdf peak
+    frameObs=VecF<double>(4);
+    frameObsCalc=VecF<bool>(4);
+    frameObsCalc[0]=true;
+    frameObsCalc[1]=vorCalc2D;
+    frameObsCalc[2]=vorCalc2D;
+    frameObsCalc[3]=rdfCalc;
+    if(blockCalc){
+        blockAvgs=VecF<BlockAverage>(4);
+        for(int i=0; i<blockAvgs.n; ++i) blockAvgs[i]=BlockAverage(40);
+    }
+
+    initTessellations();
+    initTasks();
 
     return 0;
 }
 
 
+void HDMC::initTessellations() {
+    //Construct tessellations with containers and buffers reused for every configuration
+
+    if(vorCalc2D) vor2D=Voronoi2D(cellLen_2,n,vMaximum(r),maxVertices,vorNative);
+    if(radCalc2D) rad2D=Voronoi2D(cellLen_2,n,vMaximum(w),maxVertices,vorNative);
+    if(vorCalc3D) vor3D=Voronoi3D(cellLen_2,radCut,n,vMaximum(r),maxVertices);
+    if(radCalc3D) rad3D=Voronoi3D(cellLen_2,radCut,n,vMaximum(r),maxVertices);
+}
+
+
+void HDMC::initTasks() {
+    //Run enabled analyses as concurrent tasks when threads allow, with remaining threads shared within each
+
+    int nTasks=rdfCalc+skCalc+vorCalc2D+radCalc2D+vorCalc3D+radCalc3D;
+    int poolSize=min(nTasks,nThreads);
+    taskPool=nullptr;
+    taskThreads=nThreads;
+    if(poolSize>1){
+        taskPool=make_shared<ThreadPool>(poolSize);
+        taskThreads=max(1,nThreads/poolSize);
+    }
+}
+
+
+void HDMC::resetAccumulators() {
+    //Zero accumulated analysis, keeping sizes
+
+    analysisConfigs=0;
+    rdfHist=0;
+    prdfHistAA=0;
+    prdfHistAB=0;
+    prdfHistBB=0;
+    rdfClassHist=0;
+    skK=0.0;
+    skS=0.0;
+    skSAA=0.0;
+    skSAB=0.0;
+    skSBB=0.0;
+    skCount=0;
+    psi6Series.setSize(0);
+    g6Count=0;
+    g6Sum=0.0;
+    g6SumW=0.0;
+    adfHistVor2D.reset();
+    adfHistRad2D.reset();
+    adfHistVor3D.reset();
+    adfHistRad3D.reset();
+    vor2DSizesA=0;
+    vor2DSizesB=0;
+    rad2DSizesA=0;
+    rad2DSizesB=0;
+    vor3DSizesA=0;
+    vor3DSizesB=0;
+    rad3DSizesA=0;
+    rad3DSizesB=0;
+    for(int i=0; i<vor2DAdjs.n; ++i) vor2DAdjs[i]=0;
+    for(int i=0; i<rad2DAdjs.n; ++i) rad2DAdjs[i]=0;
+    for(int i=0; i<vor3DAdjs.n; ++i) vor3DAdjs[i]=0;
+    for(int i=0; i<rad3DAdjs.n; ++i) rad3DAdjs[i]=0;
+    vor2DAreasA=0.0;
+    vor2DAreasB=0.0;
+    rad2DAreasA=0.0;
+    rad2DAreasB=0.0;
+    vor3DAreasA=0.0;
+    vor3DAreasB=0.0;
+    rad3DAreasA=0.0;
+    rad3DAreasB=0.0;
+    vor2DNNCount=0;
+    rad2DNNCount=0;
+    vor3DNNCount=0;
+    rad3DNNCount=0;
+    vor2DNNSep=0.0;
+    rad2DNNSep=0.0;
+    vor3DNNSep=0.0;
+    rad3DNNSep=0.0;
+}
+
+
+void HDMC::mergeAccumulators(HDMC &frame) {
+    //Add accumulated analysis of copy with identical analysis settings
+
+    analysisConfigs+=frame.analysisConfigs;
+    rdfHist+=frame.rdfHist;
+    prdfHistAA+=frame.prdfHistAA;
+    prdfHistAB+=frame.prdfHistAB;
+    prdfHistBB+=frame.prdfHistBB;
+    rdfClassHist+=frame.rdfClassHist;
+    skK+=frame.skK;
+    skS+=frame.skS;
+    skSAA+=frame.skSAA;
+    skSAB+=frame.skSAB;
+    skSBB+=frame.skSBB;
+    skCount+=frame.skCount;
+    for(int i=0; i<frame.psi6Series.n; ++i) psi6Series.addValue(frame.psi6Series[i]);
+    if(psi6Calc){
+        psi6Local=frame.psi6Local;
+        psi6LocalW=frame.psi6LocalW;
+    }
+    if(blockCalc) addObservables(frame.frameObs);
+    g6Count+=frame.g6Count;
+    g6Sum+=frame.g6Sum;
+    g6SumW+=frame.g6SumW;
+    adfHistVor2D.merge(frame.adfHistVor2D);
+    adfHistRad2D.merge(frame.adfHistRad2D);
+    adfHistVor3D.merge(frame.adfHistVor3D);
+    adfHistRad3D.merge(frame.adfHistRad3D);
+    vor2DSizesA+=frame.vor2DSizesA;
+    vor2DSizesB+=frame.vor2DSizesB;
+    rad2DSizesA+=frame.rad2DSizesA;
+    rad2DSizesB+=frame.rad2DSizesB;
+    vor3DSizesA+=frame.vor3DSizesA;
+    vor3DSizesB+=frame.vor3DSizesB;
+    rad3DSizesA+=frame.rad3DSizesA;
+    rad3DSizesB+=frame.rad3DSizesB;
+    for(int i=0; i<vor2DAdjs.n; ++i) vor2DAdjs[i]+=frame.vor2DAdjs[i];
+    for(int i=0; i<rad2DAdjs.n; ++i) rad2DAdjs[i]+=frame.rad2DAdjs[i];
+    for(int i=0; i<vor3DAdjs.n; ++i) vor3DAdjs[i]+=frame.vor3DAdjs[i];
+    for(int i=0; i<rad3DAdjs.n; ++i) rad3DAdjs[i]+=frame.rad3DAdjs[i];
+    vor2DAreasA+=frame.vor2DAreasA;
+    vor2DAreasB+=frame.vor2DAreasB;
+    rad2DAreasA+=frame.rad2DAreasA;
+    rad2DAreasB+=frame.rad2DAreasB;
+    vor3DAreasA+=frame.vor3DAreasA;
+    vor3DAreasB+=frame.vor3DAreasB;
+    rad3DAreasA+=frame.rad3DAreasA;
+    rad3DAreasB+=frame.rad3DAreasB;
+    vor2DNNCount+=frame.vor2DNNCount;
+    rad2DNNCount+=frame.rad2DNNCount;
+    vor3DNNCount+=frame.vor3DNNCount;
+    rad3DNNCount+=frame.rad3DNNCount;
+    vor2DNNSep+=frame.vor2DNNSep;
+    rad2DNNSep+=frame.rad2DNNSep;
+    vor3DNNSep+=frame.vor3DNNSep;
+    rad3DNNSep+=frame.rad3DNNSep;
+}
+
+
 //---------- INITIAL CONFIGURATION --------
 
 
-int HDMC::initialiseConfiguration(Logfile &logfile, string initType, double maxIt) {
+int HDMC::initialiseConfiguration(Logfile &logfile, string initType, double maxIt, double lsRate) {
     //Generate initial particle positions
 
     logfile.write("Generating Initial Configuration");
@@ -224,17 +495,7 @@ int HDMC::initialiseConfiguration(Logfile &logfile, string initType, double maxI
     w=VecF<double>(n);
 
     //Calculate simulation cell parameters
-    double area;
-    if(dispersity==1) area=(M_PI*n*pow(dispersityParams[0],2))/phi;
-    else if(dispersity==2) area=M_PI*(nA*pow(dispersityParams[0],2)+nB*pow(dispersityParams[1],2))/phi;
-    else if(dispersity==3){
-        double numDensity=phi;
-        area=n/numDensity;
-    }
-    cellLen=sqrt(area);
-    rCellLen=1.0/cellLen;
-    cellLen_2=cellLen/2.0;
-    cout<<"--- "<<n/area<<endl;
+    setCell();
 
     //Generate particle radii
     if(dispersity==1){
@@ -266,6 +527,61 @@ int HDMC::initialiseConfiguration(Logfile &logfile, string initType, double maxI
     }
 
     //Generate weights for 2D Radical
+    setWeights(logfile);
+
+    //Generate initial configuration, serially or with concurrent independent attempts
+    bool success;
+    if(initAttempts>1) success=parallelAttempts(logfile,initType,maxIt,lsRate);
+    else{
+        int attempt=1;
+        for (;;) {
+            success = initialAttempt(initType,maxIt,lsRate);
+            logfile.write("Attempt " + to_string(attempt) + " successful:", success);
+            cout << "Attempt " + to_string(attempt) + " successful: " << success << endl;
+            if(!success && initFailure!="") logfile.write("Attempt failed: "+initFailure);
+            if (success) break;
+            ++attempt;
+        }
+    }
+
+    //Set z coordinate
+    //z only used for analysis not Monte Carlo
+    if(interaction==0) z=0.0;
+    else if(interaction==1) z=r;
+
+    //Exit if cannot generate
+    if(!success) logfile.criticalError("Could not generate starting configuration");
+
+    //Initialise analysis tools here as require cell length
+    initAnalysis();
+
+    --logfile.currIndent;
+    logfile.separator();
+
+    return !success;
+}
+
+
+void HDMC::setCell() {
+    //Calculate simulation cell parameters from packing fraction or number density
+
+    double area;
+    if(dispersity==1) area=(M_PI*n*pow(dispersityParams[0],2))/phi;
+    else if(dispersity==2) area=M_PI*(nA*pow(dispersityParams[0],2)+nB*pow(dispersityParams[1],2))/phi;
+    else if(dispersity==3){
+        double numDensity=phi;
+        area=n/numDensity;
+    }
+    cellLen=sqrt(area);
+    rCellLen=1.0/cellLen;
+    cellLen_2=cellLen/2.0;
+    cout<<"--- "<<n/area<<endl;
+}
+
+
+void HDMC::setWeights(Logfile &logfile) {
+    //Generate weights for 2D radical from radii
+
     rad2DInclude=VecF<bool>(n);
     if(radCalc2DCircle) {
         for (int i = 0; i < r.n; ++i) {
@@ -287,45 +603,75 @@ int HDMC::initialiseConfiguration(Logfile &logfile, string initType, double maxI
         logfile.write("2D radical disabled due to excessive z-cut");
         radCalc2D=false;
     }
+}
 
-    //Generate initial configuration
-    bool success;
-    int attempt=1;
-    if(initType=="rsa") {
-        for (;;) {
-            success = rsaPositions(maxIt);
-            logfile.write("Attempt " + to_string(attempt) + " successful:", success);
-            cout << "Attempt " + to_string(attempt) + " successful: " << success << endl;
-            if (success) break;
-            ++attempt;
-        }
-    }
+
+bool HDMC::initialAttempt(string initType, double maxIt, double lsRate) {
+    //Single attempt at generating initial configuration
+
+    bool success=false;
+    initFailure="";
+    if(initType=="rsa") success=rsaPositions(maxIt);
     else if(initType=="swell"){
-        for (;;) {
-            generateRandomPositions();
-            success = resolvePositions();
-            logfile.write("Attempt " + to_string(attempt) + " successful:", success);
-            cout << "Attempt " + to_string(attempt) + " successful: " << success << endl;
-            if (success) break;
-            ++attempt;
-        }
+        generateRandomPositions();
+        success=resolvePositions();
     }
+    else if(initType=="ls"){
+        generateRandomPositions();
+        success=lsPositions(lsRate);
+    }
+    else if(initType=="lattice") success=latticePositions(lsRate);
 
-    //Set z coordinate
-    //z only used for analysis not Monte Carlo
-    if(interaction==0) z=0.0;
-    else if(interaction==1) z=r;
-
-    //Exit if cannot generate
-    if(!success) logfile.criticalError("Could not generate starting configuration");
+    return success;
+}
 
-    //Initialise analysis tools here as require cell length
-    initAnalysis();
 
-    --logfile.currIndent;
-    logfile.separator();
+bool HDMC::parallelAttempts(Logfile &logfile, string initType, double maxIt, double lsRate) {
+    //Run rounds of independent attempts concurrently, taking lowest numbered success
+    //a success cancels only higher numbered attempts, so outcome does not depend on timing
+
+    //Attempt k seeded from seed sequence (seed,k) so any attempt can be reproduced
+    int attemptThreads=max(1,nThreads/initAttempts);
+    for(int round=0;; ++round){
+        unique_ptr<atomic<bool>[]> cancel(new atomic<bool>[initAttempts]);
+        for(int k=0; k<initAttempts; ++k) cancel[k]=false;
+        atomic<int> winner(initAttempts);
+        vector<HDMC> attempts(initAttempts,*this);
+        parallelFor(initAttempts,0,initAttempts,[&](int b0, int b1, int t){
+            for(int k=b0; k<b1; ++k){
+                if(cancel[k]) continue;
+                HDMC &attempt=attempts[k];
+                seed_seq seq{randomSeed,round*initAttempts+k};
+                attempt.mtGen.seed(seq);
+                attempt.nThreads=attemptThreads;
+                attempt.initCancel=&cancel[k];
+                if(attempt.initialAttempt(initType,maxIt,lsRate)){
+                    int w=winner;
+                    while(k<w && !winner.compare_exchange_weak(w,k));
+                    for(int j=k+1; j<initAttempts; ++j) cancel[j]=true;
+                }
+            }
+        });
+        int won=winner;
+        if(won==initAttempts) won=-1;
+        for(int k=0; k<initAttempts; ++k){
+            int id=round*initAttempts+k;
+            if(won>=0 && k>won) break; //later attempts superseded
+            logfile.write("Attempt " + to_string(id+1) + " successful:", k==won);
+            cout << "Attempt " + to_string(id+1) + " successful: " << (k==won) << endl;
+            if(k!=won && attempts[k].initFailure!="") logfile.write("Attempt failed: "+attempts[k].initFailure);
+        }
 
-    return !success;
+        //Take configuration and random state of winning attempt
+        if(won>=0){
+            HDMC &attempt=attempts[won];
+            x=attempt.x;
+            y=attempt.y;
+            mtGen=attempt.mtGen;
+            logfile.write("Initial configuration seed sequence:",randomSeed,round*initAttempts+won);
+            return true;
+        }
+    }
 }
 
 
@@ -368,7 +714,7 @@ bool HDMC::rsaPositions(double maxIt) {
                 cout<<"Particles placed: "<<added<<endl;
             }
             ++iterations;
-            if(iterations==maxIterations){
+            if(iterations==maxIterations || (initCancel && *initCancel)){
                 success=false;
                 break;
             }
@@ -400,7 +746,7 @@ bool HDMC::rsaPositions(double maxIt) {
                 cout<<"Particles placed: "<<added<<endl;
             }
             ++iterations;
-            if(iterations==maxIterations){
+            if(iterations==maxIterations || (initCancel && *initCancel)){
                 success=false;
                 break;
             }
@@ -411,6 +757,70 @@ bool HDMC::rsaPositions(double maxIt) {
 }
 
 
+bool HDMC::lsPositions(double lsRate) {
+    //Grow particles from random positions to final radii using Lubachevsky-Stillinger algorithm
+
+    //Event driven dynamics limited to prevent stalling if system jams before reaching target
+    long maxEvents=long(n)*(1000+long(200.0/lsRate));
+    LSCompress2D ls(x,y,r,cellLen,interaction==1,lsRate);
+    bool success=ls.compress(mtGen,maxEvents,initCancel);
+    {
+        lock_guard<mutex> guard(consoleLock());
+        cout<<"LS events per particle: "<<double(ls.events)/n<<endl;
+    }
+    if(success) ls.getPositions(x,y);
+    else initFailure="LS compression "+ls.status;
+
+    return success;
+}
+
+
+bool HDMC::latticePositions(double lsRate) {
+    //Place particles on near-commensurate triangular lattice with random vacancies and species
+
+    //Lattice dimensions closest to ideal triangle aspect, row spacing sqrt(3)/2 of column spacing in square cell
+    //even number of rows for periodicity, at most a couple of rows beyond ideal so vacancies remain few
+    double aspect=sqrt(3.0)/2.0;
+    int nyIdeal=ceil(sqrt(n/aspect));
+    int nx=1,ny=2;
+    double distortion=numeric_limits<double>::infinity();
+    for(int nyTry=2; nyTry<=nyIdeal+2; nyTry+=2){
+        int nxTry=max(int(ceil(double(n)/nyTry)),int(nearbyint(nyTry*aspect)));
+        double d=fabs(double(nxTry)/nyTry/aspect-1.0);
+        if(d<distortion-1e-12 || (d<distortion+1e-12 && nxTry*nyTry<nx*ny)){
+            distortion=d;
+            nx=nxTry;
+            ny=nyTry;
+        }
+    }
+    int nSites=nx*ny;
+    double dxL=cellLen/nx;
+    double dyL=cellLen/ny;
+    cout<<"Lattice columns, rows and aspect distortion: "<<nx<<" "<<ny<<" "<<distortion<<endl;
+
+    //Randomly assign lattice sites so vacancies and species are distributed evenly
+    VecF<int> sites(nSites);
+    for(int i=0; i<nSites; ++i) sites[i]=i;
+    shuffle(sites.v,sites.v+nSites,mtGen);
+    for(int i=0; i<n; ++i){
+        int ix=sites[i]%nx;
+        int iy=sites[i]/nx;
+        x[i]=-cellLen_2+(ix+0.5*(iy%2)+0.25)*dxL;
+        y[i]=-cellLen_2+(iy+0.5)*dyL;
+    }
+    cout<<"Lattice sites and vacancies: "<<nSites<<" "<<nSites-n<<endl;
+
+    //Melt if not monodisperse or if lattice spacing smaller than particles
+    //radii compressed to fit lattice then expanded to full size with event driven dynamics
+    double spacing=min(dxL,sqrt(0.25*dxL*dxL+dyL*dyL));
+    cout<<"Lattice nearest neighbour spacing: "<<spacing<<endl;
+    bool success=true;
+    if(dispersity!=1 || spacing<2.0*vMaximum(r)) success=lsPositions(lsRate);
+
+    return success;
+}
+
+
 inline void HDMC::randomPosition(double &xx, double &yy) {
     //Generate random particle position inside periodic box
 
@@ -462,19 +872,22 @@ bool HDMC::resolvePositions() {
 
     //Set up potential model and optimiser
     HLJ2DP potModel(cellLen, cellLen);
+    potModel.setThreads(nThreads);
     SteepestDescentArmijoMultiDim<HLJ2DP> optimiser(1000,0.5,1e-12);
 
     //Increment radii and minimise iteratively
     int swellSteps=100; //number of steps to swell particles
     double swellFactor=1.0/swellSteps; //amount to swell particles by each step
     double overSwell=0.01; //amount to over-swell by
-    OutputFile xyzFile("swell.xyz");
+    unique_ptr<OutputFile> xyzFile;
+    if(!initCancel) xyzFile.reset(new OutputFile("swell.xyz")); //only written for serial attempts
     for(int k=0; k<=swellSteps; ++k){
+        if(initCancel && *initCancel) return false;
         cout<<"Swelling particles step: "<<k<<endl;
         for(int i=0,j=1; i<2*nReps; i+=2, j+=2) repParams[i]=pow((k*swellFactor+overSwell)*(r[repPairs[i]]+r[repPairs[j]]),2);
         potModel.setRepulsions(repPairs,repParams);
         optimiser(potModel,xy);
-        writeXYZ(xyzFile);
+        if(xyzFile) writeXYZ(*xyzFile);
     }
 
     //Update coordinates
@@ -537,8 +950,10 @@ inline void HDMC::mcAdditiveMove(int &counter) {
         //Translation move
 
         //Apply translation
-        xI+=transDelta*(2*rand01(mtGen)-1);
-        yI+=transDelta*(2*rand01(mtGen)-1);
+        double dxI=transDelta*(2*rand01(mtGen)-1);
+        double dyI=transDelta*(2*rand01(mtGen)-1);
+        xI+=dxI;
+        yI+=dyI;
         xI-=cellLen*nearbyint(xI*rCellLen);
         yI-=cellLen*nearbyint(yI*rCellLen);
 
@@ -561,6 +976,11 @@ inline void HDMC::mcAdditiveMove(int &counter) {
         if(accept){
             x[pI]=xI;
             y[pI]=yI;
+            if(topologyActive) topology.move(pI,xI,yI);
+            if(unwrapActive){
+                xU[unwrapId[pI]]+=dxI;
+                yU[unwrapId[pI]]+=dyI;
+            }
             ++counter;
         }
     }
@@ -579,12 +999,16 @@ inline void HDMC::mcAdditiveMove(int &counter) {
         yI=y[pJ];
 
         //Apply translations
-        xI+=transDelta*(2*rand01(mtGen)-1);
-        yI+=transDelta*(2*rand01(mtGen)-1);
+        double dxI=transDelta*(2*rand01(mtGen)-1);
+        double dyI=transDelta*(2*rand01(mtGen)-1);
+        xI+=dxI;
+        yI+=dyI;
         xI-=cellLen*nearbyint(xI*rCellLen);
         yI-=cellLen*nearbyint(yI*rCellLen);
-        xJ+=transDelta*(2*rand01(mtGen)-1);
-        yJ+=transDelta*(2*rand01(mtGen)-1);
+        double dxJ=transDelta*(2*rand01(mtGen)-1);
+        double dyJ=transDelta*(2*rand01(mtGen)-1);
+        xJ+=dxJ;
+        yJ+=dyJ;
         xJ-=cellLen*nearbyint(xJ*rCellLen);
         yJ-=cellLen*nearbyint(yJ*rCellLen);
 
@@ -632,6 +1056,17 @@ inline void HDMC::mcAdditiveMove(int &counter) {
             y[pI]=yI;
             x[pJ]=xJ;
             y[pJ]=yJ;
+            if(topologyActive) topology.swap(pI,pJ,xI,yI,xJ,yJ);
+            if(unwrapActive){
+                //swap exchanges radii between sites, so trajectories continue from sites not particles
+                int tI=unwrapId[pJ];
+                unwrapId[pJ]=unwrapId[pI];
+                unwrapId[pI]=tI;
+                xU[unwrapId[pI]]+=dxI;
+                yU[unwrapId[pI]]+=dyI;
+                xU[unwrapId[pJ]]+=dxJ;
+                yU[unwrapId[pJ]]+=dyJ;
+            }
             ++counter;
         }
     }
@@ -652,8 +1087,10 @@ inline void HDMC::mcNonAdditiveMove(int &counter) {
         //Translation move
 
         //Apply translation
-        xI+=transDelta*(2*rand01(mtGen)-1);
-        yI+=transDelta*(2*rand01(mtGen)-1);
+        double dxI=transDelta*(2*rand01(mtGen)-1);
+        double dyI=transDelta*(2*rand01(mtGen)-1);
+        xI+=dxI;
+        yI+=dyI;
         xI-=cellLen*nearbyint(xI*rCellLen);
         yI-=cellLen*nearbyint(yI*rCellLen);
 
@@ -676,6 +1113,11 @@ inline void HDMC::mcNonAdditiveMove(int &counter) {
         if(accept){
             x[pI]=xI;
             y[pI]=yI;
+            if(topologyActive) topology.move(pI,xI,yI);
+            if(unwrapActive){
+                xU[unwrapId[pI]]+=dxI;
+                yU[unwrapId[pI]]+=dyI;
+            }
             ++counter;
         }
     }
@@ -694,12 +1136,16 @@ inline void HDMC::mcNonAdditiveMove(int &counter) {
         yI=y[pJ];
 
         //Apply translations
-        xI+=transDelta*(2*rand01(mtGen)-1);
-        yI+=transDelta*(2*rand01(mtGen)-1);
+        double dxI=transDelta*(2*rand01(mtGen)-1);
+        double dyI=transDelta*(2*rand01(mtGen)-1);
+        xI+=dxI;
+        yI+=dyI;
         xI-=cellLen*nearbyint(xI*rCellLen);
         yI-=cellLen*nearbyint(yI*rCellLen);
-        xJ+=transDelta*(2*rand01(mtGen)-1);
-        yJ+=transDelta*(2*rand01(mtGen)-1);
+        double dxJ=transDelta*(2*rand01(mtGen)-1);
+        double dyJ=transDelta*(2*rand01(mtGen)-1);
+        xJ+=dxJ;
+        yJ+=dyJ;
         xJ-=cellLen*nearbyint(xJ*rCellLen);
         yJ-=cellLen*nearbyint(yJ*rCellLen);
 
@@ -747,6 +1193,17 @@ inline void HDMC::mcNonAdditiveMove(int &counter) {
             y[pI]=yI;
             x[pJ]=xJ;
             y[pJ]=yJ;
+            if(topologyActive) topology.swap(pI,pJ,xI,yI,xJ,yJ);
+            if(unwrapActive){
+                //swap exchanges radii between sites, so trajectories continue from sites not particles
+                int tI=unwrapId[pJ];
+                unwrapId[pJ]=unwrapId[pI];
+                unwrapId[pI]=tI;
+                xU[unwrapId[pI]]+=dxI;
+                yU[unwrapId[pI]]+=dyI;
+                xU[unwrapId[pJ]]+=dxJ;
+                yU[unwrapId[pJ]]+=dyJ;
+            }
             ++counter;
         }
     }
@@ -803,23 +1260,84 @@ void HDMC::equilibration(Logfile &logfile, OutputFile &xyzFile) {
     --logfile.currIndent;
     logfile.write("Translation delta set to:",transDelta);
 
-    //Equilibration
+    //Equilibration, if detection selected ending once contact number stationary over at least second half of series
+    //with at least 50 effective samples
     logfile.write("Running equilibration");
     ++logfile.currIndent;
     int logMoves=eqCycles/100;
     int accCount=0;
+    CellList2D contactCells;
+    VecR<double> contactSeries;
+    bool stationary=false;
+    if(eqDetect){
+        contactCells=CellList2D(cellLen,2.2*vMaximum(r));
+        contactSeries=VecR<double>(0,eqCycles);
+    }
     for (int i = 1; i<=eqCycles; ++i) {
         accCount+=mcCycle();
         if(i%logMoves==0){
             logfile.write("Move cycles and acceptance:",i,double(accCount)/(i*n));
             cout<<"Move cycles and acceptance: "<<i<<" "<<double(accCount)/(i*n)<<endl;
         }
+        if(eqDetect){
+            contactSeries.addValue(contactNumber(contactCells));
+            if(i>=100 && i%max(10,i/20)==0){
+                double g,nEff;
+                int t0=detectEquilibration(contactSeries,g,nEff);
+                if(2*t0<=i && nEff>=50.0){
+                    logfile.write("Contact number stationary from cycle:",t0+1);
+                    logfile.write("Statistical inefficiency and effective samples:",g,nEff);
+                    logfile.write("Equilibration ended at cycle:",i);
+                    cout<<"Equilibration ended at cycle: "<<i<<endl;
+                    stationary=true;
+                    break;
+                }
+            }
+        }
     }
+    if(eqDetect && !stationary) logfile.write("Contact number not stationary within maximum equilibration cycles");
     logfile.currIndent-=2;
     logfile.separator();
 }
 
 
+double HDMC::contactNumber(CellList2D &cells) {
+    //Mean number of neighbours per particle within 10% of contact distance
+
+    cells.build(x,y);
+    bool minImage=(cells.nc==1);
+    long contacts=0;
+    for(int c=0; c<cells.nCells; ++c){
+        int nNb,nb[4];
+        double sx[4],sy[4];
+        cells.halfNeighbours(c,nNb,nb,sx,sy);
+        for(int ii=cells.cellStart[c]; ii<cells.cellStart[c+1]; ++ii){
+            int i=cells.cellAtoms[ii];
+            for(int k=-1; k<nNb; ++k){
+                int jStart=(k==-1) ? ii+1 : cells.cellStart[nb[k]];
+                int jEnd=(k==-1) ? cells.cellStart[c+1] : cells.cellStart[nb[k]+1];
+                double shiftX=(k==-1) ? 0.0 : sx[k];
+                double shiftY=(k==-1) ? 0.0 : sy[k];
+                for(int jj=jStart; jj<jEnd; ++jj){
+                    int j=cells.cellAtoms[jj];
+                    double dx=(x[i]-x[j])-shiftX;
+                    double dy=(y[i]-y[j])-shiftY;
+                    if(minImage){
+                        dx-=cellLen*nearbyint(dx*rCellLen);
+                        dy-=cellLen*nearbyint(dy*rCellLen);
+                    }
+                    double contactSq;
+                    if(interaction==0) contactSq=pow(r[i]+r[j],2);
+                    else contactSq=4*r[i]*r[j];
+                    if(dx*dx+dy*dy<1.21*contactSq) ++contacts;
+                }
+            }
+        }
+    }
+    return 2.0*contacts/n;
+}
+
+
 int HDMC::optimalDelta(double &deltaMin, double &deltaMax, double &accProb) {
     //Find optimal translation delta by trial and improvement
 
@@ -870,7 +1388,7 @@ int HDMC::optimalDelta(double &deltaMin, double &deltaMax, double &accProb) {
 }
 
 
-void HDMC::production(Logfile &logfile, OutputFile &xyzFile, OutputFile &vor2DFile, OutputFile &rad2DFile,
+void HDMC::production(Logfile &logfile, OutputFile &xyzFile, OutputFile &trajFile, OutputFile &vor2DFile, OutputFile &rad2DFile,
                       OutputFile &vor3DFile, OutputFile &rad3DFile, OutputFile &vis2DFile, OutputFile &vis3DFile) {
     //Production Monte Carlo
 
@@ -879,9 +1397,34 @@ void HDMC::production(Logfile &logfile, OutputFile &xyzFile, OutputFile &vor2DFi
     cout<<"Production"<<endl;
     ++logfile.currIndent;
     int logMoves=prodCycles/100;
-    int accCount=0;
+    int accCount=0,accAnalysed=0;
+    if(t1Calc){
+        topology.build(x,y);
+        topologyActive=true;
+    }
+    if(dynCalc || chi4Calc){
+        xU=x;
+        yU=y;
+        unwrapId=VecF<int>(n);
+        for(int i=0; i<n; ++i) unwrapId[i]=i;
+        unwrapActive=true;
+    }
+    if(dynCalc){
+        dynCorr=MultiTauCorrelator(n,dynWavevector);
+        dynCorr.add(xU,yU);
+    }
+    if(chi4Calc){
+        //references spaced so longest lag half of production, each lag averaged over at least half the references
+        int refInterval=max(1,prodCycles/(2*chi4Refs));
+        logfile.write("Overlap reference configuration interval:",refInterval);
+        chi4Corr=OverlapCorrelator(n,chi4Probe,chi4Refs,refInterval);
+        chi4Corr.add(xU,yU);
+    }
+    if(analysisWorkers>0) startPipeline(vor2DFile,rad2DFile,vor3DFile,rad3DFile,vis2DFile,vis3DFile);
     for (int i = 1; i<=prodCycles; ++i) {
         accCount+=mcCycle();
+        if(dynCalc) dynCorr.add(xU,yU);
+        if(chi4Calc) chi4Corr.add(xU,yU);
         if(i%logMoves==0){
             logfile.write("Move cycles and acceptance:",i,double(accCount)/(i*n));
             cout<<"Move cycles and acceptance: "<<i<<" "<<double(accCount)/(i*n)<<endl;
@@ -889,14 +1432,266 @@ void HDMC::production(Logfile &logfile, OutputFile &xyzFile, OutputFile &vor2DFi
         if(i%analysisFreq==0){
             bool vis=(i%visFreq==0)*visVor2D;
             if(vis && visXYZ) writeXYZ(xyzFile);
-            analyseConfiguration(vor2DFile,rad2DFile,vor3DFile,rad3DFile,vis2DFile,vis3DFile,vis);
+            writeTrajectory(trajFile,i);
+            if(blockCalc){
+                blockAvgs[0].add(double(accCount-accAnalysed)/(analysisFreq*n));
+                accAnalysed=accCount;
+            }
+            if(pipeline) submitAnalysis(vis);
+            else analyseConfiguration(vor2DFile,rad2DFile,vor3DFile,rad3DFile,vis2DFile,vis3DFile,vis);
+            if(blockCalc && blockConverged()){
+                logfile.write("Production stopped with block averaged errors within targets at cycle:",i);
+                cout<<"Production stopped with block averaged errors within targets at cycle: "<<i<<endl;
+                break;
+            }
         }
     }
+    if(pipeline) finishPipeline();
+    topologyActive=false;
+    unwrapActive=false;
+    if(dynCalc || chi4Calc) writeDynamics(logfile);
     logfile.currIndent-=2;
     logfile.separator();
 }
 
 
+//--------- TRAJECTORY ANALYSIS ----------
+
+
+void HDMC::analyseTrajectory(Logfile &logfile, string trajPrefix, OutputFile &vor2DFile, OutputFile &rad2DFile,
+                             OutputFile &vor3DFile, OutputFile &rad3DFile, OutputFile &vis2DFile, OutputFile &vis3DFile) {
+    //Analyse configurations of existing trajectory in place of Monte Carlo
+
+    logfile.write("Trajectory Analysis");
+    cout<<"Trajectory Analysis"<<endl;
+    ++logfile.currIndent;
+
+    //Allocate vectors
+    x=VecF<double>(n);
+    y=VecF<double>(n);
+    z=VecF<double>(n);
+    r=VecF<double>(n);
+    w=VecF<double>(n);
+
+    //Radii from diameters written with trajectory, then cell and weights as for simulation
+    ifstream diaIn(trajPrefix+"_dia.dat",ios::in);
+    if(!diaIn.good()) logfile.criticalError("Cannot find diameter file "+trajPrefix+"_dia.dat");
+    string line;
+    for(int i=0; i<n; ++i){
+        double d=0.0;
+        if(!getline(diaIn,line) || !(istringstream(line)>>d)) logfile.criticalError("Diameter file has fewer than n particles");
+        r[i]=d/2.0;
+    }
+    setCell();
+    setWeights(logfile);
+    if(interaction==0) z=0.0;
+    else if(interaction==1) z=r;
+
+    //Count frames so analysis series sized for whole trajectory, with spacing read from cycles of full precision trajectory
+    //or xyz frames taken as visualisation frequency apart if only xyz available
+    ifstream trajIn(trajPrefix+"_traj.dat",ios::in);
+    bool fullTraj=trajIn.good();
+    if(!fullTraj){
+        trajIn.open(trajPrefix+".xyz",ios::in);
+        if(!trajIn.good()) logfile.criticalError("Cannot find trajectory "+trajPrefix+"_traj.dat or "+trajPrefix+".xyz");
+        logfile.write("Full precision trajectory not found, reading xyz at limited precision");
+    }
+    int nFrames=0,spacing=0;
+    if(fullTraj){
+        int firstCycle=0;
+        while(getline(trajIn,line)){
+            int num=0,cycle=0;
+            istringstream(line)>>num>>cycle;
+            if(nFrames==0) firstCycle=cycle;
+            else if(nFrames==1) spacing=cycle-firstCycle;
+            ++nFrames;
+            for(int i=0; i<num && getline(trajIn,line); ++i);
+        }
+        if(nFrames==1) spacing=firstCycle;
+    }
+    else{
+        long nLines=0;
+        while(getline(trajIn,line)) ++nLines;
+        nFrames=nLines/(n+2);
+        spacing=visFreq;
+    }
+    trajIn.clear();
+    trajIn.seekg(0);
+    if(nFrames>0 && spacing<=0) logfile.criticalError("Trajectory frame spacing must be positive");
+    logfile.write("Trajectory configurations:",nFrames);
+    logfile.write("Trajectory frame spacing (cycles):",spacing);
+
+    //T1 events need topology repaired after every move so unavailable from trajectory
+    if(t1Calc){
+        logfile.write("T1 event analysis disabled for trajectory");
+        t1Calc=false;
+    }
+    if(dynCalc || chi4Calc){
+        logfile.write("Displacement correlations disabled for trajectory");
+        dynCalc=false;
+        chi4Calc=false;
+    }
+    if(spacing>0) analysisFreq=spacing;
+    prodCycles=nFrames*analysisFreq;
+    initAnalysis();
+    frameObsCalc[0]=false; //no acceptance without simulation
+
+    //Analyse every frame inline or through pipeline, visualising frames as in simulation
+    //xyz frames were all visualisation frames of simulation
+    if(analysisWorkers>0) startPipeline(vor2DFile,rad2DFile,vor3DFile,rad3DFile,vis2DFile,vis3DFile);
+    int logFrames=max(1,nFrames/10);
+    for(int i=1; ; ++i){
+        bool vis;
+        if(fullTraj){
+            int cycle;
+            if(!readTrajectory(logfile,trajIn,cycle)) break;
+            vis=(cycle%visFreq==0)*visVor2D;
+            if(vis) ++xyzConfigs; //visualisation frames numbered as xyz frames
+        }
+        else{
+            if(!readXYZ(logfile,trajIn)) break;
+            vis=visVor2D;
+        }
+        if(pipeline) submitAnalysis(vis);
+        else analyseConfiguration(vor2DFile,rad2DFile,vor3DFile,rad3DFile,vis2DFile,vis3DFile,vis);
+        if(i%logFrames==0){
+            logfile.write("Configurations analysed:",i);
+            cout<<"Configurations analysed: "<<i<<endl;
+        }
+    }
+    if(pipeline) finishPipeline();
+    logfile.currIndent-=2;
+    logfile.separator();
+}
+
+
+//--------- ANALYSIS PIPELINE ----------
+
+
+void HDMC::startPipeline(OutputFile &vor2DFile, OutputFile &rad2DFile, OutputFile &vor3DFile,
+                         OutputFile &rad3DFile, OutputFile &vis2DFile, OutputFile &vis3DFile) {
+    //Create analysis copies for bounded number of snapshots in flight and start workers
+    //copies accumulate single configuration, merged and reset in configuration order
+
+    pipeline=make_shared<AnalysisPipeline>();
+    AnalysisPipeline &p=*pipeline;
+    p.nSlots=2*analysisWorkers;
+    p.stop=false;
+    p.nextSubmit=0;
+    p.nextRetire=0;
+    p.files={&vor2DFile,&rad2DFile,&vor3DFile,&rad3DFile,&vis2DFile,&vis3DFile};
+    p.slotVis=VecF<bool>(p.nSlots);
+    p.slotDone=VecF<bool>(p.nSlots);
+    p.slotError=vector<exception_ptr>(p.nSlots);
+    for(int s=0; s<p.nSlots; ++s){
+        p.slots.push_back(unique_ptr<HDMC>(new HDMC(*this)));
+        HDMC &frame=*p.slots[s];
+        frame.pipeline=nullptr;
+        frame.analysisWorkers=0;
+        frame.nThreads=max(1,nThreads/analysisWorkers);
+        frame.t1Calc=false; //T1 count taken from monte carlo topology at submission
+        frame.blockCalc=false; //observables added to block averages on retiring
+        frame.topologyActive=false;
+        frame.dynCalc=false; //correlations of unwrapped positions kept by monte carlo
+        frame.unwrapActive=false;
+        frame.dynCorr=MultiTauCorrelator();
+        frame.chi4Calc=false;
+        frame.chi4Corr=OverlapCorrelator();
+        frame.topology=TorusDelaunay2D();
+        frame.initTessellations();
+        frame.initTasks();
+        frame.resetAccumulators();
+        for(int k=0; k<6; ++k) p.buffers.push_back(unique_ptr<BufferFile>(new BufferFile));
+    }
+    for(int t=0; t<analysisWorkers; ++t) p.workers.push_back(thread([this,&p]{analysisWorker(p);}));
+}
+
+
+void HDMC::submitAnalysis(bool vis) {
+    //Copy current configuration into free slot and queue, blocking monte carlo whilst all slots in flight
+
+    AnalysisPipeline &p=*pipeline;
+    if(p.nextSubmit-p.nextRetire==p.nSlots) retireAnalysis();
+    int s=p.nextSubmit%p.nSlots;
+    HDMC &frame=*p.slots[s];
+    for(int i=0; i<n; ++i){
+        frame.x.v[i]=x.v[i];
+        frame.y.v[i]=y.v[i];
+        frame.z.v[i]=z.v[i];
+        frame.r.v[i]=r.v[i];
+    }
+    frame.xyzConfigs=xyzConfigs;
+    if(t1Calc) t1Series.addValue(topology.t1Count);
+    {
+        lock_guard<mutex> guard(p.lock);
+        p.slotVis[s]=vis;
+        p.slotDone[s]=false;
+        p.jobs.push_back(s);
+    }
+    p.jobReady.notify_one();
+    ++p.nextSubmit;
+}
+
+
+void HDMC::retireAnalysis() {
+    //Wait for oldest slot in flight, merge into accumulators and flush output
+    //only retired when slot needed so merged configurations independent of worker timing
+
+    AnalysisPipeline &p=*pipeline;
+    int s=p.nextRetire%p.nSlots;
+    {
+        unique_lock<mutex> guard(p.lock);
+        p.jobDone.wait(guard,[&]{return p.slotDone[s];});
+    }
+    if(p.slotError[s]) rethrow_exception(p.slotError[s]);
+    HDMC &frame=*p.slots[s];
+    mergeAccumulators(frame);
+    frame.resetAccumulators();
+    for(int k=0; k<6; ++k) p.buffers[6*s+k]->flushTo(*p.files[k]);
+    ++p.nextRetire;
+}
+
+
+void HDMC::finishPipeline() {
+    //Retire all slots in flight and join workers
+
+    AnalysisPipeline &p=*pipeline;
+    while(p.nextRetire<p.nextSubmit) retireAnalysis();
+    pipeline=nullptr;
+}
+
+
+void HDMC::analysisWorker(AnalysisPipeline &p) {
+    //Analyse queued slots into their own buffers until pipeline stopped
+
+    for(;;){
+        int s;
+        {
+            unique_lock<mutex> guard(p.lock);
+            p.jobReady.wait(guard,[&]{return p.stop || !p.jobs.empty();});
+            if(p.jobs.empty()) return;
+            s=p.jobs.front();
+            p.jobs.pop_front();
+        }
+        HDMC &frame=*p.slots[s];
+        exception_ptr error;
+        try{
+            frame.analyseConfiguration(*p.buffers[6*s],*p.buffers[6*s+1],*p.buffers[6*s+2],
+                                       *p.buffers[6*s+3],*p.buffers[6*s+4],*p.buffers[6*s+5],p.slotVis[s]);
+        }
+        catch(...){
+            error=current_exception();
+        }
+        {
+            lock_guard<mutex> guard(p.lock);
+            p.slotError[s]=error;
+            p.slotDone[s]=true;
+        }
+        p.jobDone.notify_all();
+    }
+}
+
+
 //--------- ANALYSIS ----------
 
 
@@ -904,109 +1699,218 @@ void HDMC::analyseConfiguration(OutputFile &vor2DFile, OutputFile &rad2DFile, Ou
                                 OutputFile &rad3DFile, OutputFile &vis2DFile, OutputFile &vis3DFile, bool vis) {
     //Control analysis of current configuration
 
-    if(rdfCalc) calculateRDF();
-    if(vorCalc2D) calculateVoronoi2D(vor2DFile,vis2DFile,vis);
-    if(radCalc2D) calculateRadical2D(rad2DFile,vis2DFile,vis);
-    if(vorCalc3D) calculateVoronoi3D(vor3DFile,vis2DFile,vis3DFile,vis);
-    if(radCalc3D) calculateRadical3D(rad3DFile,vis2DFile,vis3DFile,vis);
+    if(!taskPool){
+        if(rdfCalc) calculateRDF();
+        if(skCalc) calculateSK();
+        if(vorCalc2D) calculateVoronoi2D(vor2DFile,vis2DFile,vis);
+        if(radCalc2D) calculateRadical2D(rad2DFile,vis2DFile,vis);
+        if(vorCalc3D) calculateVoronoi3D(vor3DFile,vis2DFile,vis3DFile,vis);
+        if(radCalc3D) calculateRadical3D(rad3DFile,vis2DFile,vis3DFile,vis);
+    }
+    else{//analyses only read configuration and own accumulators, shared visualisation buffered and written in serial order
+        BufferFile vis2DBuffers[4],vis3DBuffers[4];
+        if(rdfCalc) taskPool->submit([&]{calculateRDF();});
+        if(skCalc) taskPool->submit([&]{calculateSK();});
+        if(vorCalc2D) taskPool->submit([&]{calculateVoronoi2D(vor2DFile,vis2DBuffers[0],vis);});
+        if(radCalc2D) taskPool->submit([&]{calculateRadical2D(rad2DFile,vis2DBuffers[1],vis);});
+        if(vorCalc3D) taskPool->submit([&]{calculateVoronoi3D(vor3DFile,vis2DBuffers[2],vis3DBuffers[2],vis);});
+        if(radCalc3D) taskPool->submit([&]{calculateRadical3D(rad3DFile,vis2DBuffers[3],vis3DBuffers[3],vis);});
+        taskPool->wait();
+        for(int i=0; i<4; ++i){
+            vis2DBuffers[i].flushTo(vis2DFile);
+            vis3DBuffers[i].flushTo(vis3DFile);
+        }
+    }
+    if(t1Calc) t1Series.addValue(topology.t1Count);
+    if(blockCalc) addObservables(frameObs);
 
     ++analysisConfigs;
 }
 
 
+void HDMC::addObservables(VecF<double> &obs) {
+    //Add scalar observables of configuration to block averages, acceptance added separately
+
+    for(int i=1; i<obs.n; ++i) if(frameObsCalc[i]) blockAvgs[i].add(obs[i]);
+}
+
+
+bool HDMC::blockConverged() {
+    //Check every observable with target has converged blocking error within relative target
+
+    bool targeted=false;
+    for(int i=0; i<blockAvgs.n; ++i){
+        if(!frameObsCalc[i] || blockTargets[i]<=0.0) continue;
+        targeted=true;
+        BlockAverage &block=blockAvgs[i];
+        if(block.optimalLevel()<0) return false;
+        if(block.error()>blockTargets[i]*fabs(block.mean[0])) return false;
+    }
+    return targeted;
+}
+
+
 void HDMC::calculateRDF() {
     //Calculate RDF for current configuration
 
-    //Calculate pairwise distances and bin
-    double xI,yI,b;
-    double dx,dy,dSq,d;
-    if(dispersity==1) {//monodisperse calculate total rdf
-        for (int i = 0; i < n - 1; ++i) {
-            xI = x[i];
-            yI = y[i];
-            for (int j = i + 1; j < n; ++j) {
-                dx = xI - x[j];
-                dy = yI - y[j];
-                dx -= cellLen * nearbyint(dx * rCellLen);
-                dy -= cellLen * nearbyint(dy * rCellLen);
-                dSq = dx * dx + dy * dy;
-                d = sqrt(dSq);
-                if (d < cellLen_2) {
-                    b = floor(d / rdfDelta);
-                    rdfHist[b] += 2;
+    //Assign particles to cells no smaller than rdf cutoff and copy coordinates and species in cell order
+    rdfCells.build(x,y);
+    VecF<double> xs(n),ys(n);
+    VecF<int> ss(n);
+    for(int k=0; k<n; ++k){
+        int i=rdfCells.cellAtoms[k];
+        xs[k]=x[i];
+        ys[k]=y[i];
+        ss[k]=rdfSpecies[i];
+    }
+    double rdfMaxSq=rdfMax*rdfMax;
+
+    //Thread private histograms with block for each species pair and overflow bin
+    int nBins=rdfHist.n;
+    int blockSize=nBins+1;
+    int nBlocks=vMaximum(rdfPairBlocks)+1;
+    int nSpecies=rdfSpecies.n>0 ? vMaximum(rdfSpecies)+1 : 1;
+    VecF<int> blockTable(nSpecies*nSpecies);
+    for(int k=0; k<blockTable.n; ++k) blockTable[k]=rdfPairBlocks[k]*blockSize;
+    VecF< VecF<int> > threadHists(taskThreads);
+
+    //Calculate distances between particles in same and neighbouring cells and bin
+    //with single cell rows of pair triangle are divided between threads, row i taken with row n-1-i to balance chunks
+    //otherwise cells are divided between threads
+    int nWork;
+    if(rdfCells.nc==1){
+        nWork=(n+1)/2;
+        parallelFor(taskThreads,0,nWork,[&](int k0, int k1, int t){
+            VecF<int> hist(nBlocks*blockSize);
+            for(int k=k0; k<k1; ++k){
+                int rows[2]={k,n-1-k};
+                int nRows=(rows[1]>k) ? 2 : 1;
+                for(int r=0; r<nRows; ++r){
+                    int ii=rows[r];
+                    const int *blockRow=blockTable.v+ss[ii]*nSpecies;
+                    binPairs<true>(xs[ii],ys[ii],xs.v+ii+1,ys.v+ii+1,ss.v+ii+1,n-ii-1,0.0,0.0,cellLen,rCellLen,
+                                   rdfMaxSq,rdfDelta,nBins,blockRow,hist.v);
                 }
             }
-        }
+            threadHists[t]=hist;
+        });
     }
-    else if(dispersity==2) {//bidisperse calculate partial then total rdfs
-        //AA
-        for (int i=0; i<nA-1; ++i) {
-            xI = x[i];
-            yI = y[i];
-            for (int j=i+1; j<nA; ++j) {
-                dx = xI - x[j];
-                dy = yI - y[j];
-                dx -= cellLen * nearbyint(dx * rCellLen);
-                dy -= cellLen * nearbyint(dy * rCellLen);
-                dSq = dx * dx + dy * dy;
-                d = sqrt(dSq);
-                if (d < cellLen_2) {
-                    b = floor(d / rdfDelta);
-                    prdfHistAA[b] += 2;
+    else{
+        nWork=rdfCells.nCells;
+        parallelFor(taskThreads,0,nWork,[&](int c0, int c1, int t){
+            VecF<int> hist(nBlocks*blockSize);
+            for(int c=c0; c<c1; ++c){
+                int nNb,nb[4];
+                double sx[4],sy[4];
+                rdfCells.halfNeighbours(c,nNb,nb,sx,sy);
+                int cEnd=rdfCells.cellStart[c+1];
+                for(int ii=rdfCells.cellStart[c]; ii<cEnd; ++ii){
+                    const int *blockRow=blockTable.v+ss[ii]*nSpecies;
+                    //Same cell, each pair once
+                    binPairs<false>(xs[ii],ys[ii],xs.v+ii+1,ys.v+ii+1,ss.v+ii+1,cEnd-ii-1,0.0,0.0,cellLen,rCellLen,
+                                    rdfMaxSq,rdfDelta,nBins,blockRow,hist.v);
+                    //Neighbouring cells
+                    for(int k=0; k<nNb; ++k){
+                        int jStart=rdfCells.cellStart[nb[k]];
+                        int jEnd=rdfCells.cellStart[nb[k]+1];
+                        binPairs<false>(xs[ii],ys[ii],xs.v+jStart,ys.v+jStart,ss.v+jStart,jEnd-jStart,sx[k],sy[k],cellLen,rCellLen,
+                                        rdfMaxSq,rdfDelta,nBins,blockRow,hist.v);
+                    }
                 }
             }
-        }
-        //AB
-        for (int i=0; i<nA; ++i) {
-            xI = x[i];
-            yI = y[i];
-            for (int j=nA; j<n; ++j) {
-                dx = xI - x[j];
-                dy = yI - y[j];
-                dx -= cellLen * nearbyint(dx * rCellLen);
-                dy -= cellLen * nearbyint(dy * rCellLen);
-                dSq = dx * dx + dy * dy;
-                d = sqrt(dSq);
-                if (d < cellLen_2) {
-                    b = floor(d / rdfDelta);
-                    prdfHistAB[b] += 2;
-                }
+            threadHists[t]=hist;
+        });
+    }
+
+    //Merge thread histograms, integer counts so identical to serial
+    int nUsed=min(taskThreads,nWork);
+    for(int t=0; t<nUsed; ++t){
+        VecF<int> &hist=threadHists[t];
+        if(dispersity==2){//bidisperse partial rdfs
+            for(int b=0; b<nBins; ++b){
+                prdfHistAA[b]+=hist[b];
+                prdfHistAB[b]+=hist[blockSize+b];
+                prdfHistBB[b]+=hist[2*blockSize+b];
             }
         }
-        //BB
-        for (int i=nA; i<n-1; ++i) {
-            xI = x[i];
-            yI = y[i];
-            for (int j=i+1; j<n; ++j) {
-                dx = xI - x[j];
-                dy = yI - y[j];
-                dx -= cellLen * nearbyint(dx * rCellLen);
-                dy -= cellLen * nearbyint(dy * rCellLen);
-                dSq = dx * dx + dy * dy;
-                d = sqrt(dSq);
-                if (d < cellLen_2) {
-                    b = floor(d / rdfDelta);
-                    prdfHistBB[b] += 2;
+        else{//mono/polydisperse total rdf, summed over polydisperse class pairs
+            for(int k=0; k<nBlocks; ++k){
+                for(int b=0; b<nBins; ++b) rdfHist[b]+=hist[k*blockSize+b];
+            }
+            if(dispersity==3 && rdfClasses>1){
+                for(int k=0; k<nBlocks; ++k){
+                    for(int b=0; b<nBins; ++b) rdfClassHist[k*nBins+b]+=hist[k*blockSize+b];
                 }
             }
         }
     }
-    if(dispersity==3) {//polydisperse calculate total rdf
-        for (int i = 0; i < n - 1; ++i) {
-            xI = x[i];
-            yI = y[i];
-            for (int j = i + 1; j < n; ++j) {
-                dx = xI - x[j];
-                dy = yI - y[j];
-                dx -= cellLen * nearbyint(dx * rCellLen);
-                dy -= cellLen * nearbyint(dy * rCellLen);
-                dSq = dx * dx + dy * dy;
-                d = sqrt(dSq);
-                if (d < cellLen_2) {
-                    b = floor(d / rdfDelta);
-                    rdfHist[b] += 2;
-                }
+
+    //Maximum of normalised total rdf for configuration, first peak height for dense systems
+    VecF<int> frameHist(nBins);
+    for(int t=0; t<nUsed; ++t){
+        for(int k=0; k<nBlocks; ++k){
+            for(int b=0; b<nBins; ++b) frameHist[b]+=threadHists[t][k*blockSize+b];
+        }
+    }
+    double norm=n*(n/pow(cellLen,2))*M_PI; //n*density*pi
+    double peak=0.0;
+    for(int b=0; b<nBins; ++b) peak=max(peak,frameHist[b]/(norm*(pow((b+1)*rdfDelta,2)-pow(b*rdfDelta,2))));
+    frameObs[3]=peak;
+}
+
+
+void HDMC::calculateSK() {
+    //Calculate static structure factor by cloud-in-cell deposit onto grid and FFT
+    //type B deposited as imaginary part so partials obtained from single transform
+
+    //Deposit particles onto grid vertices with bilinear weights
+    int m=skGrid;
+    double rH=m/cellLen;
+    skDensity=complex<double>(0.0,0.0);
+    for(int i=0; i<n; ++i){
+        double gx=(x[i]+cellLen_2)*rH;
+        double gy=(y[i]+cellLen_2)*rH;
+        int ix=floor(gx);
+        int iy=floor(gy);
+        double fx=gx-ix;
+        double fy=gy-iy;
+        int ix0=(ix%m+m)%m, ix1=(ix0+1)%m;
+        int iy0=(iy%m+m)%m, iy1=(iy0+1)%m;
+        complex<double> q(1.0,0.0);
+        if(dispersity==2 && i>=nA) q=complex<double>(0.0,1.0);
+        skDensity.v[iy0*m+ix0]+=q*((1-fx)*(1-fy));
+        skDensity.v[iy0*m+ix1]+=q*(fx*(1-fy));
+        skDensity.v[iy1*m+ix0]+=q*((1-fx)*fy);
+        skDensity.v[iy1*m+ix1]+=q*(fx*fy);
+    }
+
+    //Transform density
+    skFFT.transform(skDensity,taskThreads);
+
+    //Deconvolve assignment window, separate species and radially average
+    int maxBin=skCount.n-1;
+    for(int b=0; b<m; ++b){
+        int mb=(b<m/2) ? b : b-m;
+        if(abs(mb)>maxBin) continue;
+        double wy=(mb==0) ? 1.0 : pow(sin(M_PI*mb/m)/(M_PI*mb/m),2);
+        for(int a=0; a<m; ++a){
+            int ma=(a<m/2) ? a : a-m;
+            int bin=nearbyint(sqrt(double(ma*ma+mb*mb)));
+            if(bin==0 || bin>maxBin) continue;
+            double wx=(ma==0) ? 1.0 : pow(sin(M_PI*ma/m)/(M_PI*ma/m),2);
+            complex<double> f=skDensity.v[b*m+a]/(wx*wy);
+            complex<double> fConj=conj(skDensity.v[((m-b)%m)*m+(m-a)%m])/(wx*wy);
+            complex<double> rhoA=0.5*(f+fConj);
+            complex<double> rhoB=complex<double>(0.0,-0.5)*(f-fConj);
+            skK[bin]+=2.0*M_PI*sqrt(double(ma*ma+mb*mb))/cellLen;
+            skCount[bin]+=1;
+            if(dispersity==2){
+                skS[bin]+=norm(rhoA+rhoB)/n;
+                skSAA[bin]+=norm(rhoA)/nA;
+                skSAB[bin]+=real(rhoA*conj(rhoB))/sqrt(double(nA)*nB);
+                skSBB[bin]+=norm(rhoB)/nB;
             }
+            else skS[bin]+=norm(rhoA)/n;
         }
     }
 }
@@ -1019,9 +1923,11 @@ void HDMC::calculateVoronoi2D(OutputFile &vor2DFile, OutputFile &vis2DFile, bool
     VecF<int> cellSizeDistA,cellSizeDistB,nnCount;
     VecF<VecF<int> > cellAdjDist;
     VecF<double> cellAreaA,cellAreaB,nnSep;
-    Voronoi2D vor(x, y, r, cellLen_2, nA, false, VecF<bool>(0), maxVertices);
+    Voronoi2D &vor=vor2D;
+    vor.compute(x, y, r, nA, false, rad2DInclude, taskThreads);
     vor.analyse(maxVertices, cellSizeDistA, cellSizeDistB, cellAdjDist, cellAreaA, cellAreaB);
     vor.nnDistances(x,y,cellLen,rCellLen,nnSep,nnCount);
+    if(psi6Calc) calculatePsi6(vor);
 
     //Add results to global results
     vor2DSizesA += cellSizeDistA;
@@ -1032,10 +1938,15 @@ void HDMC::calculateVoronoi2D(OutputFile &vor2DFile, OutputFile &vis2DFile, bool
     vor2DNNSep += nnSep;
     for (int i = 0; i < cellAdjDist.n; ++i) vor2DAdjs[i] += cellAdjDist[i];
 
+    //Mean area of six-sided cells for block averaging
+    int nHex=cellSizeDistA[6]+cellSizeDistB[6];
+    frameObs[2]=(nHex>0) ? (cellAreaA[6]+cellAreaB[6])/nHex : 0.0;
+
     //Get network analysis and write for type A configuration
     for(int i=0; i<cellSizeDistA.n; ++i) if(cellSizeDistA[i]>0) cellAreaA[i]/=cellSizeDistA[i];
     VecF<double> resA = networkAnalysis(cellSizeDistA, cellAdjDist);
     vor2DFile.writeRowVector(resA);
+    frameObs[1]=resA[maxVertices]; //assortativity
 //    vor2DFile.writeRowVector(cellAreaA);
 
     //Get network analysis and write for type B configuration
@@ -1055,13 +1966,83 @@ void HDMC::calculateVoronoi2D(OutputFile &vor2DFile, OutputFile &vis2DFile, bool
 //    vor2DFile.writeRowVector(nn);
 
     //Add cell areas to distribution
-    if(adfCalc) vor.getAreas(adfHistVor2D,adfDelta);
+    if(adfCalc) vor.getAreas(adfHistVor2D);
 
     //Write Voronoi visualisation
     if(vis) writeVor(vor,vis2DFile,1);
 }
 
 
+void HDMC::calculatePsi6(Voronoi2D &vor) {
+    //Calculate local and global hexatic order from Voronoi neighbours and accumulate orientational correlation
+
+    //Local and global order, plain and weighted by Voronoi edge length
+    vor.bondOrder(x,y,cellLen,rCellLen,psi6Local,psi6LocalW);
+    complex<double> psi(0.0,0.0),psiW(0.0,0.0);
+    for(int i=0; i<n; ++i){
+        psi+=psi6Local[i];
+        psiW+=psi6LocalW[i];
+    }
+    psi6Series.addValue(abs(psi)/n);
+    psi6Series.addValue(abs(psiW)/n);
+
+    //Orientational correlation binned over pairs in same and neighbouring cells, cells divided between threads
+    g6Cells.build(x,y);
+    double rMaxSq=rdfMax*rdfMax;
+    int nBins=g6Count.n;
+    bool minImage=(g6Cells.nc==1);
+    const complex<double> *p=psi6Local.v;
+    const complex<double> *pW=psi6LocalW.v;
+    VecF< VecF<long> > threadCount(taskThreads);
+    VecF< VecF<double> > threadSum(taskThreads),threadSumW(taskThreads);
+    parallelFor(taskThreads,0,g6Cells.nCells,[&](int c0, int c1, int t){
+        VecF<long> count(nBins);
+        VecF<double> sum(nBins),sumW(nBins);
+        for(int c=c0; c<c1; ++c){
+            int nNb,nb[4];
+            double sx[4],sy[4];
+            g6Cells.halfNeighbours(c,nNb,nb,sx,sy);
+            for(int ii=g6Cells.cellStart[c]; ii<g6Cells.cellStart[c+1]; ++ii){
+                int i=g6Cells.cellAtoms[ii];
+                for(int k=-1; k<nNb; ++k){
+                    int jStart=(k==-1) ? ii+1 : g6Cells.cellStart[nb[k]];
+                    int jEnd=(k==-1) ? g6Cells.cellStart[c+1] : g6Cells.cellStart[nb[k]+1];
+                    double shiftX=(k==-1) ? 0.0 : sx[k];
+                    double shiftY=(k==-1) ? 0.0 : sy[k];
+                    for(int jj=jStart; jj<jEnd; ++jj){
+                        int j=g6Cells.cellAtoms[jj];
+                        double dx=(x[i]-x[j])-shiftX;
+                        double dy=(y[i]-y[j])-shiftY;
+                        if(minImage){
+                            dx-=cellLen*nearbyint(dx*rCellLen);
+                            dy-=cellLen*nearbyint(dy*rCellLen);
+                        }
+                        double dSq=dx*dx+dy*dy;
+                        int b=sqrt(dSq)/rdfDelta;
+                        if(dSq<rMaxSq && b<nBins){//distance just below cutoff can round into bin beyond last
+                            ++count[b];
+                            sum[b]+=real(p[i]*conj(p[j]));
+                            sumW[b]+=real(pW[i]*conj(pW[j]));
+                        }
+                    }
+                }
+            }
+        }
+        threadCount[t]=count;
+        threadSum[t]=sum;
+        threadSumW[t]=sumW;
+    });
+
+    //Merge in thread order
+    int nUsed=min(taskThreads,g6Cells.nCells);
+    for(int t=0; t<nUsed; ++t){
+        g6Count+=threadCount[t];
+        g6Sum+=threadSum[t];
+        g6SumW+=threadSumW[t];
+    }
+}
+
+
 void HDMC::calculateRadical2D(OutputFile &rad2DFile, OutputFile &vis2DFile, bool vis) {
     //Calculate radical and analyse
 
@@ -1069,7 +2050,8 @@ void HDMC::calculateRadical2D(OutputFile &rad2DFile, OutputFile &vis2DFile, bool
     VecF<int> cellSizeDistA,cellSizeDistB,nnCount;
     VecF<VecF<int> > cellAdjDist;
     VecF<double> cellAreaA,cellAreaB,nnSep;
-    Voronoi2D rad(x, y, w, cellLen_2, nA, true, rad2DInclude, maxVertices);
+    Voronoi2D &rad=rad2D;
+    rad.compute(x, y, w, nA, true, rad2DInclude, taskThreads);
     rad.analyse(maxVertices, cellSizeDistA, cellSizeDistB, cellAdjDist, cellAreaA, cellAreaB);
     rad.nnDistances(x,y,cellLen,rCellLen,nnSep,nnCount);
 
@@ -1105,7 +2087,7 @@ void HDMC::calculateRadical2D(OutputFile &rad2DFile, OutputFile &vis2DFile, bool
 //    rad2DFile.writeRowVector(nn);
 
     //Add cell areas to distribution
-    if(adfCalc) rad.getAreas(adfHistRad2D,adfDelta);
+    if(adfCalc) rad.getAreas(adfHistRad2D);
 
     //Write radical visualisation
     if(vis) writeVor(rad,vis2DFile,2,radCut);
@@ -1119,7 +2101,8 @@ void HDMC::calculateVoronoi3D(OutputFile &vor3DFile, OutputFile &vis2DFile, Outp
     VecF<int> cellSizeDistA,cellSizeDistB,nnCount;
     VecF<VecF<int> > cellAdjDist;
     VecF<double> cellAreaA,cellAreaB,nnSep;
-    Voronoi3D vor(x, y, z, r, cellLen_2, radCut, nA, false, maxVertices);
+    Voronoi3D &vor=vor3D;
+    vor.compute(x, y, z, r, nA, false, taskThreads, vis && visVor3D);
     vor.analyse(maxVertices, cellSizeDistA, cellSizeDistB, cellAdjDist, cellAreaA, cellAreaB);
     vor.nnDistances(x,y,cellLen,rCellLen,nnSep,nnCount);
 
@@ -1155,7 +2138,7 @@ void HDMC::calculateVoronoi3D(OutputFile &vor3DFile, OutputFile &vis2DFile, Outp
 //    vor3DFile.writeRowVector(nn);
 
     //Add cell areas to distribution
-    if(adfCalc) vor.getAreas(adfHistVor3D,adfDelta);
+    if(adfCalc) vor.getAreas(adfHistVor3D);
 
     //Write Voronoi visualisation
     if(vis) writeVor(vor,vis2DFile,vis3DFile,3);
@@ -1169,7 +2152,8 @@ void HDMC::calculateRadical3D(OutputFile &rad3DFile, OutputFile &vis2DFile, Outp
     VecF<int> cellSizeDistA,cellSizeDistB,nnCount;
     VecF<VecF<int> > cellAdjDist;
     VecF<double> cellAreaA,cellAreaB,nnSep;
-    Voronoi3D rad(x, y, z, r, cellLen_2, radCut, nA, true, maxVertices);
+    Voronoi3D &rad=rad3D;
+    rad.compute(x, y, z, r, nA, true, taskThreads, vis && visVor3D);
     rad.analyse(maxVertices, cellSizeDistA, cellSizeDistB, cellAdjDist, cellAreaA, cellAreaB);
     rad.nnDistances(x,y,cellLen,rCellLen,nnSep,nnCount);
 
@@ -1205,7 +2189,7 @@ void HDMC::calculateRadical3D(OutputFile &rad3DFile, OutputFile &vis2DFile, Outp
 //    rad3DFile.writeRowVector(nn);
 
     //Add cell areas to distribution
-    if(adfCalc) rad.getAreas(adfHistRad3D,adfDelta);
+    if(adfCalc) rad.getAreas(adfHistRad3D);
 
     //Write Voronoi visualisation
     if(vis) writeVor(rad,vis2DFile,vis3DFile,4,radCut);
@@ -1262,6 +2246,50 @@ void HDMC::writeXYZ(OutputFile &xyzFile) {
 }
 
 
+bool HDMC::readXYZ(Logfile &logfile, ifstream &xyzFile) {
+    //Read next configuration from XYZ file written by writeXYZ, false at end of file
+
+    string line;
+    if(!getline(xyzFile,line) || line=="") return false;
+    int num=0;
+    istringstream(line)>>num;
+    if(num!=n) logfile.criticalError("Trajectory configuration does not match number of particles");
+    getline(xyzFile,line);
+    for(int i=0; i<n; ++i){
+        if(!getline(xyzFile,line)) logfile.criticalError("Trajectory configuration incomplete");
+        string label;
+        istringstream(line)>>label>>x[i]>>y[i]; //z set from radii at full precision
+    }
+    ++xyzConfigs;
+
+    return true;
+}
+
+
+void HDMC::writeTrajectory(OutputFile &trajFile, int cycle) {
+    //Write configuration to full precision trajectory, header gives number of particles and production cycle
+
+    trajFile.write(n,cycle);
+    for(int i=0; i<n; ++i) trajFile.write(x[i],y[i]);
+}
+
+
+bool HDMC::readTrajectory(Logfile &logfile, ifstream &trajFile, int &cycle) {
+    //Read next configuration from trajectory written by writeTrajectory, false at end of file
+
+    string line;
+    if(!getline(trajFile,line) || line=="") return false;
+    int num=0;
+    istringstream(line)>>num>>cycle;
+    if(num!=n) logfile.criticalError("Trajectory configuration does not match number of particles");
+    for(int i=0; i<n; ++i){
+        if(!getline(trajFile,line) || !(istringstream(line)>>x[i]>>y[i])) logfile.criticalError("Trajectory configuration incomplete");
+    }
+
+    return true;
+}
+
+
 void HDMC::writeVor(Voronoi2D &vor, OutputFile &vis2DFile, int vorCode, double param) {
     //Write voronoi visualisation to file
 
@@ -1300,12 +2328,108 @@ void HDMC::writeVor(Voronoi3D &vor, OutputFile &vis2DFile, OutputFile &vis3DFile
     if(visVor3D){
         vis3DFile.write(xyzConfigs-1);
         vis3DFile.write(vorCode);
-        VecR< VecR<double> > faces;
         VecF<double> zLimits;
-        faces=vor.getFaces(zLimits);
+        int nFaces=vor.getFaces(zLimits);
         vis3DFile.writeRowVector(zLimits);
-        vis3DFile.write(faces.n);
-        for(int i=0; i<faces.n; ++i) vis3DFile.writeRowVector(faces[i]);
+        vis3DFile.write(nFaces);
+        for(int i=0; i<nFaces; ++i) vis3DFile.writeRowArray(&vor.faceCrds[vor.faceStart[i]],vor.faceStart[i+1]-vor.faceStart[i]);
+    }
+}
+
+
+void HDMC::writeRDFClasses() {
+    //Write polydisperse radius class partial rdfs as binary matrix
+    //int32 classes, int32 bins, float64 bin width, int32 normalised flag,
+    //float64 class edges [classes+1], int32 class counts [classes],
+    //float64 partial rdfs [classes*(classes+1)/2][bins] for class pairs a<=b in row order
+
+    ofstream file(outputPrefix+"_rdfpoly.bin",ios::out|ios::binary|ios::trunc);
+    int nBins=rdfHist.n;
+    int norm=rdfNorm;
+    file.write(reinterpret_cast<char*>(&rdfClasses),sizeof(int));
+    file.write(reinterpret_cast<char*>(&nBins),sizeof(int));
+    file.write(reinterpret_cast<char*>(&rdfDelta),sizeof(double));
+    file.write(reinterpret_cast<char*>(&norm),sizeof(int));
+    file.write(reinterpret_cast<char*>(rdfClassEdges.v),rdfClassEdges.n*sizeof(double));
+    file.write(reinterpret_cast<char*>(rdfClassCounts.v),rdfClassCounts.n*sizeof(int));
+    VecF<double> prdf(nBins);
+    int block=0;
+    for(int a=0; a<rdfClasses; ++a){
+        for(int b=a; b<rdfClasses; ++b){
+            for(int i=0; i<nBins; ++i) prdf[i]=rdfClassHist[block*nBins+i];
+            if(rdfNorm && rdfClassCounts[a]>0 && rdfClassCounts[b]>0){//empty class left as zero
+                double norm=rdfClassCounts[a]*(rdfClassCounts[b]/pow(cellLen,2))*M_PI*analysisConfigs;
+                if(a!=b) norm*=2;
+                for(int i=0; i<nBins; ++i) prdf[i]/=norm*(pow((i+1)*rdfDelta,2)-pow(i*rdfDelta,2));
+            }
+            file.write(reinterpret_cast<char*>(prdf.v),nBins*sizeof(double));
+            ++block;
+        }
+    }
+    file.close();
+}
+
+
+void HDMC::writeBlocking(Logfile &logfile) {
+    //Log block averaged observables and write standard error at each blocking level
+
+    string names[4]={"acceptance","assortativity","hexagon area","RDF peak"};
+    logfile.write("Block averaged observables");
+    ++logfile.currIndent;
+    OutputFile blockFile(outputPrefix+"_blocking.dat");
+    VecF<double> row(5);
+    for(int i=0; i<blockAvgs.n; ++i){
+        if(!frameObsCalc[i]) continue;
+        BlockAverage &block=blockAvgs[i];
+        logfile.write("Mean and standard error of "+names[i]+":",block.mean[0],block.error());
+        logfile.write("Statistical inefficiency of "+names[i]+":",block.inefficiency());
+        if(block.optimalLevel()<0) logfile.write("Blocking error not converged for "+names[i]);
+        for(int k=0; k<block.count.n && block.count[k]>=2; ++k){
+            row[0]=i;
+            row[1]=k;
+            row[2]=block.count[k];
+            row[3]=block.mean[k];
+            row[4]=block.levelError(k);
+            blockFile.writeRowVector(row);
+        }
+    }
+    --logfile.currIndent;
+}
+
+
+void HDMC::writeDynamics(Logfile &logfile) {
+    //Write displacement correlations and four-point susceptibility with lag in cycles
+
+    //Mean squared displacement and self intermediate scattering from every production cycle origin
+    if(dynCalc){
+        logfile.write("Displacement correlations written for wavevector:",dynWavevector);
+        OutputFile dynFile(outputPrefix+"_msd.dat");
+        VecF<long> lag;
+        VecF<double> msd,fs;
+        VecF<double> row(3);
+        int nLags=dynCorr.lags(lag,msd,fs);
+        for(int i=0; i<nLags; ++i){
+            row[0]=lag[i];
+            row[1]=msd[i];
+            row[2]=fs[i];
+            dynFile.writeRowVector(row);
+        }
+    }
+
+    //Mean overlap and four-point susceptibility from reference configurations
+    if(chi4Calc){
+        logfile.write("Four-point susceptibility written for probe length:",chi4Probe);
+        OutputFile chi4File(outputPrefix+"_chi4.dat");
+        VecF<long> lag;
+        VecF<double> q,chi4;
+        VecF<double> row(3);
+        int nLags=chi4Corr.results(lag,q,chi4);
+        for(int i=0; i<nLags; ++i){
+            row[0]=lag[i];
+            row[1]=q[i];
+            row[2]=chi4[i];
+            chi4File.writeRowVector(row);
+        }
     }
 }
 
@@ -1378,26 +2502,97 @@ void HDMC::writeAnalysis(Logfile &logfile, OutputFile &vor2DFile, OutputFile &ra
             }
             //Write
             for(int i=0; i<rdf.n; ++i) rdfFile.write(bins[i],rdf[i]);
+            //Radius class partial rdfs in binary
+            if(rdfClasses>1) writeRDFClasses();
+        }
+    }
+
+    //Bond orientational order time series, orientational correlation and final local order
+    if(psi6Calc){
+        OutputFile psi6File(outputPrefix+"_psi6.dat");
+        VecF<double> row(3);
+        for(int i=0; i<psi6Series.n/2; ++i){
+            row[0]=i;
+            row[1]=psi6Series[2*i];
+            row[2]=psi6Series[2*i+1];
+            psi6File.writeRowVector(row);
+        }
+        OutputFile g6File(outputPrefix+"_g6.dat");
+        for(int i=0; i<g6Count.n; ++i){
+            row[0]=rdfDelta*(i+0.5);
+            row[1]=0.0;
+            row[2]=0.0;
+            if(g6Count[i]>0){
+                row[1]=g6Sum[i]/g6Count[i];
+                row[2]=g6SumW[i]/g6Count[i];
+            }
+            g6File.writeRowVector(row);
+        }
+        OutputFile psi6LocalFile(outputPrefix+"_psi6local.dat");
+        VecF<double> local(4);
+        for(int i=0; i<psi6Local.n; ++i){
+            local[0]=real(psi6Local[i]);
+            local[1]=imag(psi6Local[i]);
+            local[2]=real(psi6LocalW[i]);
+            local[3]=imag(psi6LocalW[i]);
+            psi6LocalFile.writeRowVector(local);
+        }
+    }
+
+    //T1 events in each analysis interval, accumulated and rate per particle per cycle
+    if(t1Calc){
+        OutputFile t1File(outputPrefix+"_t1.dat");
+        VecF<double> row(4);
+        for(int i=0; i<t1Series.n; ++i){
+            long interval=t1Series[i];
+            if(i>0) interval-=t1Series[i-1];
+            row[0]=i;
+            row[1]=interval;
+            row[2]=t1Series[i];
+            row[3]=double(interval)/(n*analysisFreq);
+            t1File.writeRowVector(row);
+        }
+    }
+
+    //Block averaged observables
+    if(blockCalc) writeBlocking(logfile);
+
+    //Structure factor, averaged over wavevectors in each bin and configurations
+    if(skCalc){
+        OutputFile skFile(outputPrefix+"_sk.dat");
+        VecF<double> row(2);
+        if(dispersity==2) row=VecF<double>(5);
+        for(int i=1; i<skCount.n; ++i){
+            if(skCount[i]==0) continue;
+            row[0]=skK[i]/skCount[i];
+            row[1]=skS[i]/skCount[i];
+            if(dispersity==2){
+                row[2]=skSAA[i]/skCount[i];
+                row[3]=skSAB[i]/skCount[i];
+                row[4]=skSBB[i]/skCount[i];
+            }
+            skFile.writeRowVector(row);
         }
     }
 
     //ADF
     if(adfCalc){
         OutputFile adfFile(outputPrefix+"_adf.dat");
-        VecF<double> bins(adfHistVor2D.n);
-        for(int i=0; i<bins.n; ++i) bins[i]=adfDelta*(i+0.5);
-        VecF< VecR<double> > adfHist(bins.n);
-        int totalSum=vSum(adfHistVor2D)+vSum(adfHistRad2D)+vSum(adfHistVor3D)+vSum(adfHistRad3D);
-        int currSum=0;
-        for(int i=0; i<bins.n; ++i){
+        //Write occupied range common to all histograms
+        int minBin=numeric_limits<int>::max(), maxBin=-1;
+        AreaHistogram *hists[4]={&adfHistVor2D,&adfHistRad2D,&adfHistVor3D,&adfHistRad3D};
+        for(int i=0; i<4; ++i){
+            if(hists[i]->total==0) continue;
+            minBin=min(minBin,hists[i]->minBin);
+            maxBin=max(maxBin,hists[i]->maxBin);
+        }
+        for(int b=minBin; b<=maxBin; ++b){
             VecR<int> row(0,4);
-            if(vorCalc2D) row.addValue(adfHistVor2D[i]);
-            if(radCalc2D) row.addValue(adfHistRad2D[i]);
-            if(vorCalc3D) row.addValue(adfHistVor3D[i]);
-            if(radCalc3D) row.addValue(adfHistRad3D[i]);
-            for(int j=0; j<row.n; ++j) currSum+=row[j];
-            if (currSum>0) adfFile.writeValRowVector(bins[i],row);
-            if(currSum==totalSum) break;
+            if(vorCalc2D) row.addValue(adfHistVor2D.count(b));
+            if(radCalc2D) row.addValue(adfHistRad2D.count(b));
+            if(vorCalc3D) row.addValue(adfHistVor3D.count(b));
+            if(radCalc3D) row.addValue(adfHistRad3D.count(b));
+            adfFile.writeValRowVector(adfDelta*(b+0.5),row);
         }
     }
 
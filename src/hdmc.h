@@ -6,6 +6,12 @@
 #include <sstream>
 #include <iomanip>
 #include <random>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 #include "outputfile.h"
 #include "vecf.h"
 #include "vecr.h"
@@ -14,6 +20,16 @@
 #include "voronoi3d.h"
 #include "pot2d.h"
 #include "opt.h"
+#include "lscompress2d.h"
+#include "parallel.h"
+#include "celllist.h"
+#include "pairkernel.h"
+#include "fft.h"
+#include "torusdelaunay2d.h"
+#include "blockaverage.h"
+#include "correlator.h"
+
+struct AnalysisPipeline;
 
 class HDMC {
     //Hard disk Monte Carlo class
@@ -28,10 +44,12 @@ public:
     double phi; //packing fraction
     double cellLen,rCellLen,cellLen_2; //cell length, reciprocal and half
     double radCut; //cut for radical voronoi
+    bool vorNative; //2D tessellations from native periodic Delaunay rather than voro++
     VecF<double> x,y,z,r,w; //particle x coords, y coords, z coords, radii and weights for radical voronoi
     VecF<bool> rad2DInclude; //particles to include for radical tessellation
 
     //Random number generation
+    int randomSeed; //seed for random number generation
     mt19937 mtGen; //mersenne twister random generator
     uniform_int_distribution<int> randParticle; //uniform distribution for particle selection
     uniform_real_distribution<double> rand01; //uniform distribution between 0 and 1
@@ -41,6 +59,17 @@ public:
     double transProb,swapProb; //translation and swap move probability
     double acceptTarget; //move acceptance target
     double transDelta; //shift for translations
+    bool eqDetect; //end equilibration once contact number stationary
+
+    //Parallelisation parameters
+    int nThreads; //number of threads
+    int initAttempts; //number of concurrent initial configuration attempts
+    atomic<bool> *initCancel; //cancellation flag for concurrent attempts
+    string initFailure; //reason last initial configuration attempt failed, empty if no reason given
+    int analysisWorkers; //number of pipelined analysis workers, 0 analyses inline
+    shared_ptr<AnalysisPipeline> pipeline; //configuration snapshots queued for analysis workers
+    shared_ptr<ThreadPool> taskPool; //workers running independent analyses of configuration concurrently
+    int taskThreads; //threads available within each analysis
 
     //Analysis and output parameters
     string outputPrefix; //output file path and prefix
@@ -50,9 +79,48 @@ public:
     int analysisFreq,visFreq; //frequency of analysis/visualisation
     int analysisConfigs, xyzConfigs; //number of analysis/xyz configurations
     double rdfDelta,adfDelta; //RDF/ADF bin width
+    double rdfMax; //RDF cutoff distance
+    CellList2D rdfCells; //cell list for RDF
+    VecF<int> rdfSpecies,rdfPairBlocks; //species of each particle and histogram block of each species pair for RDF
+    int rdfClasses; //number of polydisperse radius classes
+    VecF<double> rdfClassEdges; //smallest radius in each class and largest overall
+    VecF<int> rdfClassCounts,rdfClassHist; //particles in each class and class pair RDF histograms
+    bool skCalc; //structure factor flag
+    int skGrid; //structure factor grid points along each side
+    FFT2D skFFT; //structure factor transform
+    VecF< complex<double> > skDensity; //gridded density
+    VecF<double> skK,skS,skSAA,skSAB,skSBB; //structure factor wavevector magnitude and total/partial sums by bin
+    VecF<int> skCount; //number of wavevectors in each bin
+    bool psi6Calc; //bond orientational order flag
+    VecF< complex<double> > psi6Local,psi6LocalW; //local hexatic order, plain and Voronoi edge weighted
+    VecR<double> psi6Series; //global hexatic order magnitude each configuration, plain and weighted
+    CellList2D g6Cells; //cell list for orientational correlation
+    VecF<long> g6Count; //pairs in each g6 bin
+    VecF<double> g6Sum,g6SumW; //sum of psi6 correlation in each g6 bin, plain and weighted
+    bool t1Calc; //T1 event flag
+    bool topologyActive; //maintain Delaunay topology through accepted moves
+    TorusDelaunay2D topology; //periodic Delaunay triangulation repaired after every accepted move
+    VecR<long> t1Series; //accumulated T1 events at each configuration
+    bool blockCalc; //block averaging of scalar observables
+    VecF<double> blockTargets; //relative standard error of each observable to stop production, 0 no target
+    VecF<double> frameObs; //acceptance, assortativity, hexagon area and RDF peak of current configuration
+    VecF<bool> frameObsCalc; //observables available
+    VecF<BlockAverage> blockAvgs; //block averages of each observable
+    bool dynCalc; //multi-tau displacement correlations through production
+    bool unwrapActive; //track unwrapped positions through accepted moves
+    double dynWavevector; //wavevector of self intermediate scattering
+    VecF<double> xU,yU; //unwrapped coordinates of each continuous trajectory
+    VecF<int> unwrapId; //trajectory currently followed by each particle, exchanged by swaps
+    MultiTauCorrelator dynCorr; //mean squared displacement and self intermediate scattering correlator
+    bool chi4Calc; //overlap function and four-point susceptibility through production
+    double chi4Probe; //overlap probe length
+    int chi4Refs; //reference configurations held for overlap function
+    OverlapCorrelator chi4Corr; //overlap function and four-point susceptibility correlator
     VecF<int> rdfHist,prdfHistAA,prdfHistAB,prdfHistBB; //RDF histogram
-    VecF<int> adfHistVor2D,adfHistRad2D,adfHistVor3D,adfHistRad3D; //ADF histograms
+    AreaHistogram adfHistVor2D,adfHistRad2D,adfHistVor3D,adfHistRad3D; //ADF histograms, range adapted to observed areas
     int maxVertices; //set maximum on number of vertices
+    Voronoi2D vor2D,rad2D; //voronoi/radical tessellations reused for every configuration
+    Voronoi3D vor3D,rad3D; //voronoi/radical tessellations reused for every configuration
     VecF<int> vor2DSizesA,vor2DSizesB,rad2DSizesA,rad2DSizesB; //voronoi/radical cell sizes
     VecF<int> vor3DSizesA,vor3DSizesB,rad3DSizesA,rad3DSizesB; //voronoi/radical cell sizes
     VecF< VecF<int> > vor2DAdjs,rad2DAdjs; //voronoi/radical cell size adjacencies
@@ -68,34 +136,90 @@ public:
     HDMC();
     int setParticles(int num, double packFrac, int disp, VecF<double> dispParams, int interact); //set particle properties
     int setRandom(int seed); //set random number generation
-    int setSimulation(int eq, int prod, double swap, double accTarg); //set simulation parameters
-    int setAnalysis(string path, int anFreq, int rdf, double rdfDel, int adf, double adfDel, VecF<int> vor, double radZ, int visF, int vis3); //set analysis parameters
+    int setSimulation(int eq, int prod, double swap, double accTarg, int eqDet); //set simulation parameters
+    int setParallel(int threads, int attempts, int workers); //set parallelisation parameters
+    int setAnalysis(string path, int anFreq, int rdf, double rdfDel, double rdfMaximum, int rdfCls, int skGridPoints, int adf, double adfDel, VecF<int> vor, double radZ, int vorEng, int psi6, int t1, int block, VecF<double> blockTarg, int dyn, double dynK, int chi4, double chi4A, int chi4R, int visF, int vis3); //set analysis parameters
 
     //Member functions
-    int initialiseConfiguration(Logfile &logfile, string initType, double maxIt); //generate initial particle positions
+    int initialiseConfiguration(Logfile &logfile, string initType, double maxIt, double lsRate); //generate initial particle positions
+    void setCell(); //calculate simulation cell length
+    void setWeights(Logfile &logfile); //generate 2D radical weights from radii
+    bool initialAttempt(string initType, double maxIt, double lsRate); //single initial configuration attempt
+    bool parallelAttempts(Logfile &logfile, string initType, double maxIt, double lsRate); //concurrent initial configuration attempts
     bool rsaPositions(double maxIt); //generate positions using rsa algorithm
+    bool lsPositions(double lsRate); //generate positions using Lubachevsky-Stillinger compression
+    bool latticePositions(double lsRate); //generate positions on triangular lattice
     void generateRandomPositions(); //generate random particle positions
     void randomPosition(double &xx, double &yy); //generate random particle position
     bool resolvePositions(); //resolve overlaps using steepest descent minimisation
     int initAnalysis(); //initialise analysis tools
+    void initTessellations(); //construct reusable voronoi/radical tessellations
+    void initTasks(); //divide threads between concurrent analyses
+    void resetAccumulators(); //zero accumulated analysis
+    void mergeAccumulators(HDMC &frame); //add accumulated analysis of another copy
     void equilibration(Logfile &logfile, OutputFile &xyzFile); //equilibration Monte Carlo
-    void production(Logfile &logfile, OutputFile &xyzFile, OutputFile &vor2DFile, OutputFile &rad2DFile, OutputFile &vor3DFile, OutputFile &rad3DFile, OutputFile &vis2DFile, OutputFile &vis3DFile); //production Monte Carlo
+    void production(Logfile &logfile, OutputFile &xyzFile, OutputFile &trajFile, OutputFile &vor2DFile, OutputFile &rad2DFile, OutputFile &vor3DFile, OutputFile &rad3DFile, OutputFile &vis2DFile, OutputFile &vis3DFile); //production Monte Carlo
+    void analyseTrajectory(Logfile &logfile, string trajPrefix, OutputFile &vor2DFile, OutputFile &rad2DFile, OutputFile &vor3DFile, OutputFile &rad3DFile, OutputFile &vis2DFile, OutputFile &vis3DFile); //analyse configurations of existing trajectory
     void analyseConfiguration(OutputFile &vor2DFile, OutputFile &rad2DFile, OutputFile &vor3DFile, OutputFile &rad3DFile, OutputFile &vis2DFile,  OutputFile &vis3DFile, bool vis); //analyse current configuration
+    void startPipeline(OutputFile &vor2DFile, OutputFile &rad2DFile, OutputFile &vor3DFile, OutputFile &rad3DFile, OutputFile &vis2DFile, OutputFile &vis3DFile); //create analysis copies and workers
+    void submitAnalysis(bool vis); //snapshot current configuration and queue for analysis
+    void retireAnalysis(); //merge oldest analysis in flight
+    void finishPipeline(); //complete queued analyses and stop workers
+    void analysisWorker(AnalysisPipeline &p); //analyse queued snapshots until stopped
     void calculateRDF(); //calculate RDF for current configuration
+    void calculateSK(); //calculate structure factor for current configuration
     void calculateVoronoi2D(OutputFile &vor2DFile, OutputFile &visFile, bool vis); //calculate Voronoi and analyse
+    void calculatePsi6(Voronoi2D &vor); //calculate bond orientational order from Voronoi neighbours
     void calculateRadical2D(OutputFile &rad2DFile, OutputFile &visFile, bool vis); //calculate Radical Voronoi and analyse
     void calculateVoronoi3D(OutputFile &vor3DFile, OutputFile &vis2DFile, OutputFile &vis3DFile, bool vis); //calculate Voronoi and analyse
     void calculateRadical3D(OutputFile &rad3DFile, OutputFile &vis2DFile, OutputFile &vis3DFile, bool vis); //calculate Radical Voronoi and analyse
+    void addObservables(VecF<double> &obs); //add configuration observables to block averages
+    bool blockConverged(); //all targeted observables within relative error target
     VecF<double> networkAnalysis(VecF<int> &sizes, VecF< VecF<int> > &adjs); //network analysis of sizes
+    double contactNumber(CellList2D &cells); //mean number of near contacts per particle
     int optimalDelta(double &deltaMin, double &deltaMax, double &accProb); //find optimal translational delta
     int mcCycle(); //set of n-particle Monte Carlo moves
     void mcAdditiveMove(int &counter); //single Monte Carlo move with additive distances
     void mcNonAdditiveMove(int &counter); //single Monte Carlo move with non-additive distances
     void writeXYZ(OutputFile &xyzFile); //write configuration to xyz file
+    bool readXYZ(Logfile &logfile, ifstream &xyzFile); //read next configuration from xyz file
+    void writeTrajectory(OutputFile &trajFile, int cycle); //write configuration to full precision trajectory
+    bool readTrajectory(Logfile &logfile, ifstream &trajFile, int &cycle); //read next configuration from full precision trajectory
     void writeVor(Voronoi2D &vor, OutputFile &vis2DFile, int vorCode, double param=0.0); //write voronoi visualisation
     void writeVor(Voronoi3D &vor, OutputFile &vis2DFile, OutputFile &vis3DFile, int vorCode, double param=0.0); //write voronoi visualisation
+    void writeRDFClasses(); //write polydisperse radius class rdfs
+    void writeBlocking(Logfile &logfile); //log block averaged observables and write blocking analysis
+    void writeDynamics(Logfile &logfile); //write displacement correlations and four-point susceptibility
     void writeAnalysis(Logfile &logfile, OutputFile &vor2DFile, OutputFile &rad2DFile, OutputFile &vor3DFile, OutputFile &rad3DFile, OutputFile &diaFile); //write analysis results to file
 };
 
 
+struct AnalysisPipeline {
+    //Bounded ring of configuration snapshots analysed by worker threads and retired in order
+
+    int nSlots; //number of snapshots in flight
+    vector< unique_ptr<HDMC> > slots; //analysis copy holding snapshot and accumulators of single configuration
+    vector< unique_ptr<BufferFile> > buffers; //output of each slot held until retired, six per slot
+    vector<OutputFile*> files; //destination output files
+    VecF<bool> slotVis,slotDone; //visualisation flag and completion of each slot
+    vector<exception_ptr> slotError; //exception raised analysing each slot
+    deque<int> jobs; //slots waiting for a worker
+    vector<thread> workers; //worker threads
+    mutex lock; //guards queue and slot status
+    condition_variable jobReady,jobDone; //signal queued and completed slots
+    bool stop; //workers exit when queue empty
+    int nextSubmit,nextRetire; //configuration counters, slot is configuration modulo slots
+
+    //Stop and join any running workers
+    ~AnalysisPipeline(){
+        {
+            lock_guard<mutex> guard(lock);
+            stop=true;
+        }
+        jobReady.notify_all();
+        for(int i=0; i<int(workers.size()); ++i) workers[i].join();
+    }
+};
+
+
 #endif //HDMC_HDMC_H
@@ -0,0 +1,478 @@
+#include "lscompress2d.h"
+
+
+LSCompress2D::LSCompress2D(VecF<double> &xx, VecF<double> &yy, VecF<double> &rr, double cellLen, bool nonAdd, double growthRate) {
+    //Initialise with starting positions and final radii
+
+    n=xx.n;
+    len=cellLen;
+    rLen=1.0/len;
+    len_2=0.5*len;
+    nonAdditive=nonAdd;
+    growth=growthRate;
+    sEnd=1.0+1e-6; //slight over-growth guarantees no overlap at final radii
+    x=xx;
+    y=yy;
+    r=rr;
+    vx=VecF<double>(n);
+    vy=VecF<double>(n);
+    t=VecF<double>(n);
+    count=VecF<int>(n);
+    id=VecF<int>(n);
+    for(int i=0; i<n; ++i) id[i]=i;
+    evT=VecF<double>(n);
+    evJ=VecF<int>(n);
+    evCountJ=VecF<int>(n);
+    heap=VecF<int>(n);
+    heapPos=VecF<int>(n);
+    next=VecF<int>(n);
+    prev=VecF<int>(n);
+    cell=VecF<int>(n);
+    cellX=VecF<int>(n);
+    cellY=VecF<int>(n);
+    time=0.0;
+    events=0;
+
+    //Velocity scale set by mean contact distance so dynamics independent of units
+    vScale=2.0*vMean(r);
+    v2Target=2.0*n*vScale*vScale;
+
+    //Starting cells must be at least as large as largest final contact distance
+    maxContact=2.0*vMaximum(r)*sEnd;
+    for(int i=0; i<n; ++i){
+        x[i]-=len*nearbyint(x[i]*rLen);
+        y[i]-=len*nearbyint(y[i]*rLen);
+    }
+    buildCells(maxContact);
+}
+
+
+inline double LSCompress2D::contact(int i, int j) {
+    //Contact distance at final radii
+
+    if(nonAdditive) return 2.0*sqrt(r[i]*r[j]);
+    else return r[i]+r[j];
+}
+
+
+inline double LSCompress2D::minImage(double d) {
+    //Minimum image convention, rounding only needed when separation outside half cell
+
+    if(d<-len_2 || d>len_2) d-=len*floor(d*rLen+0.5);
+    return d;
+}
+
+
+inline double LSCompress2D::wrap(double d) {
+    //Periodic boundary, rounding only needed when coordinate has left cell
+
+    if(d<-len_2 || d>=len_2) d-=len*floor(d*rLen+0.5);
+    return d;
+}
+
+
+inline void LSCompress2D::advance(int i) {
+    //Move particle along trajectory to current time
+
+    double dt=time-t.v[i];
+    x.v[i]=wrap(x.v[i]+vx.v[i]*dt);
+    y.v[i]=wrap(y.v[i]+vy.v[i]*dt);
+    t.v[i]=time;
+}
+
+
+double LSCompress2D::scale() {
+    //Radius scale factor at current time
+
+    return s0+growth*time;
+}
+
+
+void LSCompress2D::buildCells(double minSize) {
+    //Set grid of cells no smaller than given size and insert particles
+
+    nc=floor(len/minSize);
+    if(nc<3) nc=1; //all particles neighbours
+    cellSize=len/nc;
+    head=VecF<int>(nc*nc);
+    head=-1;
+    for(int i=n-1; i>=0; --i){
+        int cx=floor((x[i]+len_2)/cellSize);
+        int cy=floor((y[i]+len_2)/cellSize);
+        cx=min(max(cx,0),nc-1);
+        cy=min(max(cy,0),nc-1);
+        cellX[i]=cx;
+        cellY[i]=cy;
+        addToCell(i,cy*nc+cx);
+    }
+}
+
+
+void LSCompress2D::addToCell(int i, int c) {
+    //Insert particle at head of cell list
+
+    cell[i]=c;
+    prev[i]=-1;
+    next[i]=head[c];
+    if(head[c]!=-1) prev[head[c]]=i;
+    head[c]=i;
+}
+
+
+void LSCompress2D::removeFromCell(int i) {
+    //Remove particle from cell list
+
+    if(prev[i]!=-1) next[prev[i]]=next[i];
+    else head[cell[i]]=next[i];
+    if(next[i]!=-1) prev[next[i]]=prev[i];
+}
+
+
+void LSCompress2D::neighbourCells(int c, int &nNb, int nb[9]) {
+    //Get cells neighbouring (and including) given cell
+
+    if(nc==1){
+        nNb=1;
+        nb[0]=0;
+        return;
+    }
+    int cx=c%nc;
+    int cy=c/nc;
+    nNb=0;
+    for(int dy=-1; dy<=1; ++dy){
+        int ny=(cy+dy+nc)%nc;
+        for(int dx=-1; dx<=1; ++dx){
+            int nx=(cx+dx+nc)%nc;
+            nb[nNb++]=ny*nc+nx;
+        }
+    }
+}
+
+
+void LSCompress2D::nextEvent(int i) {
+    //Find earliest collision or cell crossing for particle
+
+    advance(i);
+    double te=numeric_limits<double>::infinity();
+    int partner=-1, partnerCount=0;
+
+    //Cell crossing, using minimum image distances to cell walls
+    if(nc>1){
+        double xLo=-len_2+cellX[i]*cellSize;
+        double yLo=-len_2+cellY[i]*cellSize;
+        if(vx[i]>0) te=max(minImage(xLo+cellSize-x[i]),0.0)/vx[i];
+        else if(vx[i]<0) te=min(minImage(xLo-x[i]),0.0)/vx[i];
+        double ty=numeric_limits<double>::infinity();
+        if(vy[i]>0) ty=max(minImage(yLo+cellSize-y[i]),0.0)/vy[i];
+        else if(vy[i]<0) ty=min(minImage(yLo-y[i]),0.0)/vy[i];
+        if(ty<te) te=ty;
+    }
+
+    //Collisions with particles in neighbouring cells
+    //solve |dr+dv*tau|=d*(s+g*tau) for smallest positive tau, no root if separating faster than growth
+    double s=scale();
+    double g2=growth*growth;
+    const double *px=x.v, *py=y.v, *pvx=vx.v, *pvy=vy.v, *pt=t.v, *pr=r.v;
+    const int *pNext=next.v;
+    double xI=px[i], yI=py[i], vxI=pvx[i], vyI=pvy[i], rI=pr[i];
+    int nNb, nb[9];
+    neighbourCells(cell[i],nNb,nb);
+    for(int k=0; k<nNb; ++k){
+        for(int j=head.v[nb[k]]; j!=-1; j=pNext[j]){
+            if(j==i) continue;
+            double dtj=time-pt[j];
+            double dvx=pvx[j]-vxI;
+            double dvy=pvy[j]-vyI;
+            double dx=minImage(px[j]+pvx[j]*dtj-xI);
+            double dy=minImage(py[j]+pvy[j]*dtj-yI);
+            double d=nonAdditive ? 2.0*sqrt(rI*pr[j]) : rI+pr[j];
+            double d2=d*d;
+            double a=dvx*dvx+dvy*dvy-d2*g2;
+            double b=dx*dvx+dy*dvy-d2*s*growth;
+            if(b>=0.0 && a>=0.0) continue;
+            double c=dx*dx+dy*dy-d2*s*s;
+            if(c<0.0) c=0.0;
+            double disc=b*b-a*c;
+            double tau;
+            if(b<0.0){
+                if(disc<0.0) continue;
+                tau=c/(-b+sqrt(disc)); //approaching
+            }
+            else tau=(b+sqrt(disc))/(-a); //separating slower than growth
+            if(tau<te){
+                te=tau;
+                partner=j;
+            }
+        }
+    }
+    if(partner>=0) partnerCount=count[partner];
+
+    evT[i]=te+time;
+    evJ[i]=partner;
+    evCountJ[i]=partnerCount;
+}
+
+
+void LSCompress2D::predict(int i) {
+    //Replace event of particle in calendar
+
+    nextEvent(i);
+    siftUp(heapPos[i]);
+    siftDown(heapPos[i]);
+}
+
+
+void LSCompress2D::siftUp(int k) {
+    //Move entry up heap until parent event earlier
+
+    int *h=heap.v, *hPos=heapPos.v;
+    const double *et=evT.v;
+    int i=h[k];
+    while(k>0){
+        int p=(k-1)/2;
+        if(et[h[p]]<=et[i]) break;
+        h[k]=h[p];
+        hPos[h[k]]=k;
+        k=p;
+    }
+    h[k]=i;
+    hPos[i]=k;
+}
+
+
+void LSCompress2D::siftDown(int k) {
+    //Move entry down heap until children events later
+
+    int *h=heap.v, *hPos=heapPos.v;
+    const double *et=evT.v;
+    int i=h[k];
+    for(;;){
+        int c=2*k+1;
+        if(c>=n) break;
+        if(c+1<n && et[h[c+1]]<et[h[c]]) ++c;
+        if(et[i]<=et[h[c]]) break;
+        h[k]=h[c];
+        hPos[h[k]]=k;
+        k=c;
+    }
+    h[k]=i;
+    hPos[i]=k;
+}
+
+
+void LSCompress2D::collide(int i, int j) {
+    //Elastic collision in frame moving with growing surfaces
+
+    advance(i);
+    advance(j);
+    double dx=minImage(x[j]-x[i]);
+    double dy=minImage(y[j]-y[i]);
+    double dr=sqrt(dx*dx+dy*dy);
+    dx/=dr;
+    dy/=dr;
+    double u=(vx[j]-vx[i])*dx+(vy[j]-vy[i])*dy; //normal relative velocity
+    double du=contact(i,j)*growth-u; //half change so separation exceeds growth
+    if(du<0.0) du=0.0;
+    v2Sum-=vx[i]*vx[i]+vy[i]*vy[i]+vx[j]*vx[j]+vy[j]*vy[j];
+    vx[i]-=du*dx;
+    vy[i]-=du*dy;
+    vx[j]+=du*dx;
+    vy[j]+=du*dy;
+    v2Sum+=vx[i]*vx[i]+vy[i]*vy[i]+vx[j]*vx[j]+vy[j]*vy[j];
+    ++count[i];
+    ++count[j];
+    predict(i);
+    predict(j);
+}
+
+
+void LSCompress2D::crossCell(int i) {
+    //Move particle into neighbouring cell in direction of travel
+
+    advance(i);
+    double xLo=-len_2+cellX[i]*cellSize;
+    double yLo=-len_2+cellY[i]*cellSize;
+    double tx=numeric_limits<double>::infinity();
+    double ty=numeric_limits<double>::infinity();
+    if(vx[i]>0) tx=max(minImage(xLo+cellSize-x[i]),0.0)/vx[i];
+    else if(vx[i]<0) tx=min(minImage(xLo-x[i]),0.0)/vx[i];
+    if(vy[i]>0) ty=max(minImage(yLo+cellSize-y[i]),0.0)/vy[i];
+    else if(vy[i]<0) ty=min(minImage(yLo-y[i]),0.0)/vy[i];
+    if(tx<ty) cellX[i]=(cellX[i]+(vx[i]>0 ? 1 : -1)+nc)%nc;
+    else cellY[i]=(cellY[i]+(vy[i]>0 ? 1 : -1)+nc)%nc;
+    removeFromCell(i);
+    addToCell(i,cellY[i]*nc+cellX[i]);
+    predict(i);
+}
+
+
+void LSCompress2D::synchronise() {
+    //Bring all particles to current time and rescale velocities to remove heat of growth collisions
+    //particles stored in cell order so neighbours close in memory, cells shrunk to contact distance
+    //up to scale 5% further on (but no smaller than mean spacing as smaller cells only add crossings)
+    //all events then repredicted and next synchronisation set for when cells become too small
+
+    for(int i=0; i<n; ++i) advance(i);
+    double v2=0.0;
+    for(int i=0; i<n; ++i) v2+=vx[i]*vx[i]+vy[i]*vy[i];
+    double f=sqrt(v2Target/v2);
+    vx*=f;
+    vy*=f;
+    v2Sum=v2Target;
+
+    //Reorder particles by cell
+    double s=scale();
+    double spacing=len/sqrt(double(n));
+    double minSize=max(maxContact*min(s+0.05,sEnd)/sEnd,spacing);
+    if(minSize>maxContact) minSize=maxContact;
+    buildCells(minSize);
+    VecF<int> order(n);
+    int m=0;
+    for(int c=0; c<nc*nc; ++c) for(int i=head[c]; i!=-1; i=next[i]) order[m++]=i;
+    VecF<double> tmp(n);
+    VecF<int> tmpId(n);
+    for(int k=0; k<n; ++k) tmp[k]=x[order[k]];
+    x=tmp;
+    for(int k=0; k<n; ++k) tmp[k]=y[order[k]];
+    y=tmp;
+    for(int k=0; k<n; ++k) tmp[k]=vx[order[k]];
+    vx=tmp;
+    for(int k=0; k<n; ++k) tmp[k]=vy[order[k]];
+    vy=tmp;
+    for(int k=0; k<n; ++k) tmp[k]=r[order[k]];
+    r=tmp;
+    for(int k=0; k<n; ++k) tmpId[k]=id[order[k]];
+    id=tmpId;
+    buildCells(minSize);
+    count=0;
+
+    //Repredict all events and rebuild calendar
+    for(int i=0; i<n; ++i){
+        nextEvent(i);
+        heap[i]=i;
+        heapPos[i]=i;
+    }
+    for(int k=n/2-1; k>=0; --k) siftDown(k);
+
+    //Cells valid until largest contact reaches cell size
+    double sCell=cellSize*sEnd/maxContact;
+    tSync=min(tEnd,(sCell-s0)/growth);
+}
+
+
+double LSCompress2D::initialScale() {
+    //Find scale factor at which starting positions are free of overlaps
+
+    double minRatio=numeric_limits<double>::infinity();
+    int nNb, nb[9];
+    for(int i=0; i<n; ++i){
+        neighbourCells(cell[i],nNb,nb);
+        for(int k=0; k<nNb; ++k){
+            for(int j=head[nb[k]]; j!=-1; j=next[j]){
+                if(j<=i) continue;
+                double dx=minImage(x[j]-x[i]);
+                double dy=minImage(y[j]-y[i]);
+                double ratio=sqrt(dx*dx+dy*dy)/contact(i,j);
+                if(ratio<minRatio) minRatio=ratio;
+            }
+        }
+    }
+
+    return min(0.9*minRatio,sEnd);
+}
+
+
+bool LSCompress2D::checkOverlaps() {
+    //Check for overlaps at final radii
+
+    int nNb, nb[9];
+    for(int i=0; i<n; ++i){
+        neighbourCells(cell[i],nNb,nb);
+        for(int k=0; k<nNb; ++k){
+            for(int j=head[nb[k]]; j!=-1; j=next[j]){
+                if(j<=i) continue;
+                double dx=minImage(x[j]-x[i]);
+                double dy=minImage(y[j]-y[i]);
+                double d=contact(i,j);
+                if(dx*dx+dy*dy<d*d) return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+bool LSCompress2D::compress(mt19937 &gen, long maxEvents, atomic<bool> *cancel) {
+    //Run event driven dynamics while growing radii until final radii reached
+    //calendar holds single next event per particle, stale if partner has since collided
+
+    //Random velocities with zero total momentum
+    normal_distribution<double> normalDist(0.0,1.0);
+    for(int i=0; i<n; ++i){
+        vx[i]=normalDist(gen);
+        vy[i]=normalDist(gen);
+    }
+    vx-=vMean(vx);
+    vy-=vMean(vy);
+
+    //Start from scale at which there are no overlaps
+    s0=initialScale();
+    tEnd=(sEnd-s0)/growth;
+    synchronise();
+
+    //Process events in time order until final scale reached
+    events=0;
+    for(;;){
+        int i=heap[0];
+        if(evT[i]>=tSync){
+            if(tSync>=tEnd) break;
+            time=tSync;
+            synchronise();
+            continue;
+        }
+        time=evT[i];
+        int j=evJ[i];
+        if(j>=0){
+            if(evCountJ[i]!=count[j]){
+                predict(i); //partner velocity changed since prediction
+                continue;
+            }
+            collide(i,j);
+        }
+        else crossCell(i);
+        ++events;
+        if(v2Sum>1.1*v2Target) tSync=time; //synchronise once heated by 10%
+        if(events%(100l*n)==0){//concurrent attempts may report together
+            lock_guard<mutex> guard(consoleLock());
+            cout<<"LS radius scale factor and events: "<<scale()<<" "<<events<<endl;
+        }
+        if(events>maxEvents){
+            status="event limit reached at radius scale factor "+to_string(scale())
+                   +", increase ls growth rate, or reduce it if radius scale factor stalls as system jams";
+            return false;
+        }
+        if(cancel && *cancel){
+            status="cancelled";
+            return false;
+        }
+    }
+
+    //Bring all particles to final time
+    time=tEnd;
+    for(int i=0; i<n; ++i) advance(i);
+
+    bool valid=checkOverlaps();
+    status=valid ? "converged" : "overlaps remain at final radii";
+    return valid;
+}
+
+
+void LSCompress2D::getPositions(VecF<double> &xx, VecF<double> &yy) {
+    //Copy particle positions in original order
+
+    for(int i=0; i<n; ++i){
+        xx[id[i]]=x[i];
+        yy[id[i]]=y[i];
+    }
+}
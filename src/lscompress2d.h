@@ -0,0 +1,77 @@
+#ifndef HDMC_LSCOMPRESS2D_H
+#define HDMC_LSCOMPRESS2D_H
+
+#include <iostream>
+#include <random>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "vecf.h"
+#include "vec_func.h"
+#include "parallel.h"
+
+using namespace std;
+
+class LSCompress2D {
+    //Lubachevsky-Stillinger compression of hard disks by event driven dynamics with growing radii
+
+private:
+
+    //Data members
+    int n; //number of particles
+    double len,rLen,len_2; //cell length, reciprocal and half
+    bool nonAdditive; //non-additive contact distances
+    double growth; //rate of increase of radius scale factor
+    double s0,sEnd; //initial and final radius scale factor
+    double time; //current global time
+    double tEnd; //time at which final radii reached
+    double tSync; //time of next synchronisation of all particles
+    double vScale; //thermal velocity scale
+    double v2Sum,v2Target; //current and target sum of squared velocities
+    double maxContact; //largest final contact distance
+    VecF<double> x,y,vx,vy,t,r; //positions, velocities, local times and final radii
+    VecF<int> count; //number of velocity changes of each particle
+    VecF<int> id; //original index of each particle, storage reordered by cell for locality
+    int nc; //number of cells along each side
+    double cellSize; //cell length
+    VecF<int> cell,cellX,cellY,head,next,prev; //linked cell lists
+    VecF<double> evT; //time of next event of each particle
+    VecF<int> evJ,evCountJ; //partner of next event (-1 cell crossing) and its collision count at prediction
+    VecF<int> heap,heapPos; //calendar as binary heap of particles ordered by event time, and position in heap
+
+    //Member functions
+    inline double contact(int i, int j); //final contact distance
+    inline void advance(int i); //bring particle to current time
+    inline double minImage(double d); //minimum image separation
+    inline double wrap(double d); //wrap coordinate into cell
+    void buildCells(double minSize); //set cell grid no smaller than given size and fill cell lists
+    void addToCell(int i, int c); //insert particle into cell list
+    void removeFromCell(int i); //remove particle from cell list
+    void neighbourCells(int c, int &nNb, int nb[9]); //cells neighbouring given cell
+    void nextEvent(int i); //find next event for particle
+    void predict(int i); //find next event for particle and reorder calendar
+    void siftUp(int k); //move heap entry towards root
+    void siftDown(int k); //move heap entry towards leaves
+    void collide(int i, int j); //process collision
+    void crossCell(int i); //process cell crossing
+    void synchronise(); //bring all particles to current time, rescale velocities, reorder and regrid
+    double initialScale(); //largest overlap free scale factor for starting positions
+    bool checkOverlaps(); //check final configuration
+
+public:
+
+    //Constructor
+    LSCompress2D(VecF<double> &xx, VecF<double> &yy, VecF<double> &rr, double cellLen, bool nonAdd, double growthRate);
+
+    //Data members
+    long events; //number of events processed
+    string status; //outcome of compression, reason for failure
+
+    //Member functions
+    bool compress(mt19937 &gen, long maxEvents, atomic<bool> *cancel=nullptr); //grow radii to final values
+    void getPositions(VecF<double> &xx, VecF<double> &yy); //final particle positions
+    double scale(); //current radius scale factor
+};
+
+
+#endif //HDMC_LSCOMPRESS2D_H
@@ -6,6 +6,8 @@
 
 using namespace std;
 
+int run(Logfile &logfile, int argc, char **argv);
+
 int main(int argc, char **argv) {
 
     //Set up logfile
@@ -15,6 +17,32 @@ int main(int argc, char **argv) {
     logfile.write("Written By: David OM, Wilson Group, 2019");
     logfile.separator();
 
+    //Run, errors thrown as strings or by critical error (already logged) reported and exit with failure
+    try{
+        return run(logfile,argc,argv);
+    }
+    catch(string &e){
+        logfile.currIndent=0;
+        logfile.write("Critical error: "+e);
+        cerr<<"Critical error: "<<e<<endl;
+    }
+    catch(exception &e){
+        logfile.currIndent=0;
+        logfile.write("Terminated: "+string(e.what()));
+        cerr<<"Terminated: "<<e.what()<<endl;
+    }
+    return 1;
+}
+
+
+int run(Logfile &logfile, int argc, char **argv) {
+    //Read input parameters then run simulation or analyse existing trajectory
+
+    //Run mode, "analyse [prefix]" analyses existing trajectory, default prefix from input file
+    bool analyseMode=(argc>1 && string(argv[1])=="analyse");
+    string trajPrefix;
+    if(analyseMode && argc>2) trajPrefix=argv[2];
+
     //Read input parameters
     logfile.write("Reading input parameters");
     ifstream inputFile("./hdmc.inpt", ios::in);
@@ -84,9 +112,14 @@ int main(int argc, char **argv) {
     for(int i=0; i<2; ++i) getline(inputFile,skip);
     int randomSeed; //seed for random number generator
     int eqCycles, prodCycles; //number of equilibration and production cycles
+    int eqDetect; //automatic equilibration detection
     string initType; //initial configuration generation type
     double rsaIt; //power for maximum iteractions in rsa algorithm
+    double lsRate; //radius growth rate in ls algorithm
     double swapProb,accTarget; //swap probability and acceptance probability target
+    int nThreads; //number of threads
+    int initAttempts; //number of concurrent initial configuration attempts
+    int analysisWorkers; //number of pipelined analysis workers
     getline(inputFile,line);
     istringstream(line)>>randomSeed;
     logfile.write("Random seed:",randomSeed);
@@ -97,9 +130,15 @@ int main(int argc, char **argv) {
     istringstream(line)>>rsaIt;
     logfile.write("RSA maximum iterations:",rsaIt);
     getline(inputFile,line);
+    istringstream(line)>>lsRate;
+    logfile.write("LS growth rate:",lsRate);
+    getline(inputFile,line);
     istringstream(line)>>eqCycles;
     logfile.write("Equilibration moves per particle:",eqCycles);
     getline(inputFile,line);
+    istringstream(line)>>eqDetect;
+    logfile.write("Automatic equilibration detection:",eqDetect);
+    getline(inputFile,line);
     istringstream(line)>>prodCycles;
     logfile.write("Production moves per particle:",prodCycles);
     getline(inputFile,line);
@@ -108,19 +147,41 @@ int main(int argc, char **argv) {
     getline(inputFile,line);
     istringstream(line)>>accTarget;
     logfile.write("Target acceptance probability:",accTarget);
+    getline(inputFile,line);
+    istringstream(line)>>nThreads;
+    logfile.write("Number of threads:",nThreads);
+    getline(inputFile,line);
+    istringstream(line)>>initAttempts;
+    logfile.write("Concurrent initial configuration attempts:",initAttempts);
+    getline(inputFile,line);
+    istringstream(line)>>analysisWorkers;
+    logfile.write("Pipelined analysis workers:",analysisWorkers);
     --logfile.currIndent;
     //Analysis parameters
     logfile.write("Reading analysis parameters");
     ++logfile.currIndent;
     for(int i=0; i<2; ++i) getline(inputFile,skip);
     string outputPrefix;
-    int analysisFreq,rdfAnalysis,adfAnalysis;
-    double rdfDelta,adfDelta;
+    int analysisFreq,rdfAnalysis,rdfClasses,skGrid,adfAnalysis;
+    double rdfDelta,rdfMax,adfDelta;
     VecF<int> vorAnalysis(4);
     double radCut;
+    int vorEngine;
+    int psi6Analysis;
+    int t1Analysis;
+    int blockAnalysis;
+    VecF<double> blockTargets(4);
+    int dynAnalysis;
+    double dynWavevector;
+    int chi4Analysis,chi4Refs;
+    double chi4Probe;
     getline(inputFile,line);
     istringstream(line)>>outputPrefix;
     logfile.write("Output prefix:",outputPrefix);
+    if(analyseMode){
+        if(trajPrefix=="") trajPrefix=outputPrefix;
+        logfile.write("Trajectory prefix:",trajPrefix);
+    }
     getline(inputFile,line);
     istringstream(line)>>analysisFreq;
     logfile.write("Analysis frequency (cycles):",analysisFreq);
@@ -131,6 +192,16 @@ int main(int argc, char **argv) {
     istringstream(line)>>rdfDelta;
     logfile.write("Radial distribution function bin width:",rdfDelta);
     getline(inputFile,line);
+    istringstream(line)>>rdfMax;
+    logfile.write("Radial distribution function maximum distance:",rdfMax);
+    getline(inputFile,line);
+    istringstream(line)>>rdfClasses;
+    logfile.write("Radial distribution function polydisperse radius classes:",rdfClasses);
+    if(rdfClasses>n) logfile.criticalError("Radial distribution function radius classes exceed number of particles");
+    getline(inputFile,line);
+    istringstream(line)>>skGrid;
+    logfile.write("Structure factor grid points:",skGrid);
+    getline(inputFile,line);
     istringstream(line)>>adfAnalysis;
     logfile.write("Area distribution function calculation:",adfAnalysis);
     getline(inputFile,line);
@@ -147,6 +218,36 @@ int main(int argc, char **argv) {
     getline(inputFile,line);
     istringstream(line)>>radCut;
     logfile.write("2D radical cut parameter:",radCut);
+    getline(inputFile,line);
+    istringstream(line)>>vorEngine;
+    logfile.write("2D tessellation engine:",vorEngine);
+#ifndef HDMC_USE_VORO
+    //Only native 2D engine available without voro++
+    if(vorAnalysis[2]==1 || vorAnalysis[3]==1) logfile.criticalError("3D Voronoi analysis requires build with HDMC_USE_VORO");
+    if(vorEngine!=1 && (vorAnalysis[0]==1 || vorAnalysis[1]>0)) logfile.criticalError("2D tessellation engine 0 requires build with HDMC_USE_VORO");
+#endif
+    getline(inputFile,line);
+    istringstream(line)>>psi6Analysis;
+    logfile.write("Bond orientational order analysis:",psi6Analysis);
+    getline(inputFile,line);
+    istringstream(line)>>t1Analysis;
+    logfile.write("T1 event analysis:",t1Analysis);
+    getline(inputFile,line);
+    istringstream(line)>>blockAnalysis;
+    logfile.write("Block averaging analysis:",blockAnalysis);
+    getline(inputFile,line);
+    istringstream ssBlock(line);
+    for(int i=0; i<blockTargets.n; ++i) ssBlock>>blockTargets[i];
+    logfile.write("Block averaging relative error targets:",blockTargets[0],blockTargets[1]);
+    logfile.write("Block averaging relative error targets:",blockTargets[2],blockTargets[3]);
+    getline(inputFile,line);
+    istringstream(line)>>dynAnalysis>>dynWavevector;
+    logfile.write("Multi-tau displacement correlations:",dynAnalysis);
+    logfile.write("Self intermediate scattering wavevector:",dynWavevector);
+    getline(inputFile,line);
+    istringstream(line)>>chi4Analysis>>chi4Probe>>chi4Refs;
+    logfile.write("Four-point susceptibility:",chi4Analysis);
+    logfile.write("Overlap probe length and reference configurations:",chi4Probe,chi4Refs);
     --logfile.currIndent;
     //Visualisation parameters
     logfile.write("Reading analysis parameters");
@@ -171,29 +272,40 @@ int main(int argc, char **argv) {
     logfile.write("Particle parameters set");
     simulation.setRandom(randomSeed);
     logfile.write("Random number generators initialised");
-    simulation.setSimulation(eqCycles,prodCycles,swapProb,accTarget);
+    simulation.setSimulation(eqCycles,prodCycles,swapProb,accTarget,eqDetect);
     logfile.write("Simulation parameters set");
-    simulation.setAnalysis(outputPrefix,analysisFreq,rdfAnalysis,rdfDelta,adfAnalysis,adfDelta,vorAnalysis,radCut,visFreq,vis3D);
+    simulation.setParallel(nThreads,initAttempts,analysisWorkers);
+    logfile.write("Parallelisation parameters set");
+    simulation.setAnalysis(outputPrefix,analysisFreq,rdfAnalysis,rdfDelta,rdfMax,rdfClasses,skGrid,adfAnalysis,adfDelta,vorAnalysis,radCut,vorEngine,psi6Analysis,t1Analysis,blockAnalysis,blockTargets,dynAnalysis,dynWavevector,chi4Analysis,chi4Probe,chi4Refs,visFreq,vis3D);
     logfile.write("Analysis and write parameters set");
     --logfile.currIndent;
     logfile.separator();
 
     //Set up output files
-    OutputFile xyzFile(outputPrefix+".xyz");
     OutputFile vor2DFile(outputPrefix+"_vor2d.dat");
     OutputFile rad2DFile(outputPrefix+"_rad2d.dat");
     OutputFile vor3DFile(outputPrefix+"_vor3d.dat");
     OutputFile rad3DFile(outputPrefix+"_rad3d.dat");
     OutputFile vis2DFile(outputPrefix+"_vis2d.dat");
     OutputFile vis3DFile(outputPrefix+"_vis3d.dat");
-    OutputFile diaFile(outputPrefix+"_dia.dat");
 
-    //Run Monte Carlo simulation (xyz written only for production atm)
-    simulation.initialiseConfiguration(logfile,initType,rsaIt);
-    simulation.equilibration(logfile,xyzFile);
-    simulation.production(logfile,xyzFile,vor2DFile,rad2DFile,vor3DFile,rad3DFile,vis2DFile,vis3DFile);
+    if(analyseMode){
+        //Analyse existing trajectory and diameters in place of simulation
+        simulation.analyseTrajectory(logfile,trajPrefix,vor2DFile,rad2DFile,vor3DFile,rad3DFile,vis2DFile,vis3DFile);
+    }
+    else{
+        //Run Monte Carlo simulation (xyz written only for production atm)
+        //full precision trajectory of every analysed configuration for re-analysis
+        OutputFile xyzFile(outputPrefix+".xyz");
+        OutputFile trajFile(outputPrefix+"_traj.dat");
+        trajFile.file<<scientific<<setprecision(16);
+        simulation.initialiseConfiguration(logfile,initType,rsaIt,lsRate);
+        simulation.equilibration(logfile,xyzFile);
+        simulation.production(logfile,xyzFile,trajFile,vor2DFile,rad2DFile,vor3DFile,rad3DFile,vis2DFile,vis3DFile);
+    }
 
-    //Write analysis to files
+    //Write analysis to files, diameters opened last as may be trajectory input
+    OutputFile diaFile(outputPrefix+"_dia.dat");
     simulation.writeAnalysis(logfile,vor2DFile,rad2DFile,vor3DFile,rad3DFile,diaFile);
 
     return 0;
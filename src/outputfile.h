@@ -4,6 +4,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <chrono>
 #include <iomanip>
 #include <stdexcept>
@@ -31,6 +32,10 @@ public:
     explicit OutputFile(const string name): file(name,ios::in|ios::trunc){
         initVariables();
     }
+    explicit OutputFile(streambuf *buf){
+        file.basic_ios<char>::rdbuf(buf);
+        initVariables();
+    }
 
     //Destructor
     ~OutputFile(){file.close();}
@@ -84,6 +89,14 @@ public:
         file<<endl;
     }
 
+    template <typename T>
+    void writeRowArray(const T *vec, int n){
+        for(int i=0; i<n; ++i){
+            file<<setw(spacing)<<left<<vec[i];
+        }
+        file<<endl;
+    }
+
     template <typename T, typename U>
     void writeValRowVector(T val, U vec){
         for(int i=0; i<currIndent; ++i) file<<indent;
@@ -96,6 +109,28 @@ public:
 
 };
 
+//File held in memory until flushed to another output file
+class BufferFile: public OutputFile{
+
+public:
+
+    //Data members
+    stringbuf buffer;
+
+    //Constructor
+    BufferFile():OutputFile(&buffer){};
+
+    //Destructor
+    ~BufferFile(){file.basic_ios<char>::rdbuf(file.rdbuf());}
+
+    //Member functions
+    void flushTo(OutputFile &dest){
+        dest.file<<buffer.str();
+        buffer.str("");
+    }
+
+};
+
 //Logfile
 class Logfile: public OutputFile{
 
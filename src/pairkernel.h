@@ -0,0 +1,47 @@
+//Batched Pair Distance Histogram Kernel
+#ifndef HDMC_PAIRKERNEL_H
+#define HDMC_PAIRKERNEL_H
+
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+/* Bin distances from particle I to a contiguous block of particles J
+ * Distances are computed for a batch in a branch-free loop which vectorises at -O3 on baseline x86-64,
+ * requires -fno-math-errno for sqrt and -fno-trapping-math to if-convert the comparisons.
+ * Pairs beyond the cutoff are sent to an overflow bin rather than skipped.
+ * Bins are then scattered in a scalar loop, hist is laid out as [block][bin] and block for each pair is given by blockRow[specJ]
+ * Coordinates of J are shifted by (sx,sy) into the image adjacent to I, or with minImage
+ * the minimum image convention is applied instead, by selects rather than nearbyint as
+ * coordinates are in the box so |dx|<len (matches nearbyint including ties) */
+const int pairKernelBatch=64; //pairs per batch
+
+template <bool minImage>
+inline void binPairs(double xI, double yI, const double *xJ, const double *yJ, const int *specJ, int nJ,
+                     double sx, double sy, double len, double rLen, double rMaxSq, double delta, int overflow,
+                     const int *blockRow, int *hist){
+    int bins[pairKernelBatch];
+    double overflowBin=overflow;
+    for(int k0=0; k0<nJ; k0+=pairKernelBatch){
+        int nK=min(pairKernelBatch,nJ-k0);
+        const double *xK=xJ+k0, *yK=yJ+k0;
+        //Squared distances and bins
+        for(int k=0; k<nK; ++k){
+            double dx=(xI-xK[k])-sx;
+            double dy=(yI-yK[k])-sy;
+            if(minImage){
+                double tx=dx*rLen, ty=dy*rLen;
+                dx-=len*((tx>0.5 ? 1.0 : 0.0)-(tx<-0.5 ? 1.0 : 0.0));
+                dy-=len*((ty>0.5 ? 1.0 : 0.0)-(ty<-0.5 ? 1.0 : 0.0));
+            }
+            double dSq=dx*dx+dy*dy;
+            double b=sqrt(dSq)/delta;
+            bins[k]=dSq<rMaxSq ? b : overflowBin;
+        }
+        //Scatter to histogram
+        for(int k=0; k<nK; ++k) hist[blockRow[specJ[k0+k]]+bins[k]]+=2;
+    }
+}
+
+#endif //HDMC_PAIRKERNEL_H
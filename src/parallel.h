@@ -0,0 +1,145 @@
+//Thread Parallelism Helpers
+#ifndef NL_PARALLEL_H
+#define NL_PARALLEL_H
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <string>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+using namespace std;
+
+//Lock held while writing to console from code that may run in concurrent tasks
+inline mutex &consoleLock(){
+    static mutex lock;
+    return lock;
+}
+
+/* Split range [begin,end) into contiguous chunks, one per thread
+ * Function is called as func(chunkBegin,chunkEnd,threadId)
+ * Chunk boundaries depend only on range and thread count
+ * Exceptions are caught in each thread and first in chunk order rethrown in caller once all joined */
+template <typename F>
+void parallelFor(int nThreads, int begin, int end, F func){
+    int range=end-begin;
+    if(nThreads>range) nThreads=range;
+    if(nThreads<=1){
+        if(range>0) func(begin,end,0);
+        return;
+    }
+    vector<exception_ptr> errors(nThreads);
+    auto chunk=[&](int b0, int b1, int t){
+        try{
+            func(b0,b1,t);
+        }
+        catch(...){
+            errors[t]=current_exception();
+        }
+    };
+    vector<thread> threads;
+    threads.reserve(nThreads-1);
+    for(int t=0; t<nThreads-1; ++t){
+        int b0=begin+(long(range)*t)/nThreads;
+        int b1=begin+(long(range)*(t+1))/nThreads;
+        threads.push_back(thread(chunk,b0,b1,t));
+    }
+    chunk(begin+(long(range)*(nThreads-1))/nThreads,end,nThreads-1);
+    for(int t=0; t<int(threads.size()); ++t) threads[t].join();
+    for(int t=0; t<nThreads; ++t) if(errors[t]) rethrow_exception(errors[t]);
+}
+
+/* Fixed set of worker threads running submitted tasks in any order
+ * Wait blocks until all submitted tasks complete then rethrows first
+ * exception in submission order */
+class ThreadPool {
+
+public:
+
+    //Make non-copyable
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    //Constructor
+    explicit ThreadPool(int nThreads): stop(false), pending(0){
+        for(int t=0; t<nThreads; ++t) workers.push_back(thread([this]{run();}));
+    }
+
+    //Destructor
+    ~ThreadPool(){
+        {
+            lock_guard<mutex> guard(lock);
+            stop=true;
+        }
+        taskReady.notify_all();
+        for(int t=0; t<int(workers.size()); ++t) workers[t].join();
+    }
+
+    //Member functions
+    int size(){
+        return workers.size();
+    }
+
+    void submit(function<void()> task){
+        {
+            lock_guard<mutex> guard(lock);
+            tasks.push_back(make_pair(int(errors.size()),task));
+            errors.push_back(nullptr);
+            ++pending;
+        }
+        taskReady.notify_one();
+    }
+
+    void wait(){
+        unique_lock<mutex> guard(lock);
+        allDone.wait(guard,[&]{return pending==0;});
+        vector<exception_ptr> taskErrors;
+        taskErrors.swap(errors);
+        guard.unlock();
+        for(int i=0; i<int(taskErrors.size()); ++i) if(taskErrors[i]) rethrow_exception(taskErrors[i]);
+    }
+
+private:
+
+    vector<thread> workers;
+    deque< pair<int,function<void()> > > tasks; //submission index and task
+    vector<exception_ptr> errors; //exception raised by each task since last wait
+    mutex lock;
+    condition_variable taskReady,allDone;
+    bool stop;
+    int pending;
+
+    void run(){
+        for(;;){
+            pair<int,function<void()> > task;
+            {
+                unique_lock<mutex> guard(lock);
+                taskReady.wait(guard,[&]{return stop || !tasks.empty();});
+                if(tasks.empty()) return;
+                task=tasks.front();
+                tasks.pop_front();
+            }
+            exception_ptr error;
+            try{
+                task.second();
+            }
+            catch(...){
+                error=current_exception();
+            }
+            bool done;
+            {
+                lock_guard<mutex> guard(lock);
+                errors[task.first]=error;
+                done=(--pending==0);
+            }
+            if(done) allDone.notify_all();
+        }
+    }
+
+};
+
+#endif //NL_PARALLEL_H
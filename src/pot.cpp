@@ -10,6 +10,10 @@ BasePotentialModel::BasePotentialModel() {
     useIntx=false;
     useFixd=false;
     useGcns=false;
+    nThreads=1;
+    sumBlock=4096;
+    bndsIndexed=false;
+    repsIndexed=false;
 }
 
 //Setters: interactions types
@@ -17,6 +21,7 @@ void BasePotentialModel::setBonds(VecF<int> bonds, VecF<double> params) {
     bnds=bonds;
     bndP=params;
     useBnds=true;
+    bndsIndexed=false;
 }
 
 void BasePotentialModel::setAngles(VecF<int> angles, VecF<double> params) {
@@ -29,6 +34,7 @@ void BasePotentialModel::setRepulsions(VecF<int> repulsions, VecF<double> params
     reps=repulsions;
     repP=params;
     useReps=true;
+    repsIndexed=false;
 }
 
 void BasePotentialModel::setIntersections(VecF<int> intersections, VecF<double> params) {
@@ -48,6 +54,24 @@ void BasePotentialModel::setGeomConstraints(VecF<int> constrained, VecF<double>
     useGcns=true;
 }
 
+void BasePotentialModel::setThreads(int threads) {
+    nThreads=threads;
+    if(nThreads<1) nThreads=1;
+}
+
+void BasePotentialModel::indexInteractions(VecF<int> &pairs, int nAtoms, VecF<int> &start, VecF<int> &atom) {
+    //Compressed list of pair interactions involving each atom, in ascending interaction order
+    start=VecF<int>(nAtoms+1);
+    atom=VecF<int>(pairs.n);
+    for(int i=0; i<pairs.n; ++i) ++start[pairs[i]+1];
+    for(int i=0; i<nAtoms; ++i) start[i+1]+=start[i];
+    VecF<int> fill(start);
+    for(int i=0, k=0; i<pairs.n; i+=2, ++k){
+        atom[fill[pairs[i]]++]=k;
+        atom[fill[pairs[i+1]]++]=k;
+    }
+}
+
 void BasePotentialModel::reset() {
     useBnds=false;
     useAngs=false;
@@ -206,13 +230,25 @@ double BasePotentialModel2D::angsPotential(VecF<double> &x) {
 }
 
 double BasePotentialModel2D::repsPotential(VecF<double> &x) {
+    //Partial sums over fixed blocks of repulsions, so total is independent of thread count
+    int nReps=reps.n/2;
+    int nBlocks=(nReps+sumBlock-1)/sumBlock;
+    VecF<double> uBlock(nBlocks);
+    parallelFor(nThreads,0,nBlocks,[&](int b0, int b1, int t){
+        int id0, id1;
+        for(int b=b0; b<b1; ++b){
+            double u=0.0;
+            int kEnd=min((b+1)*sumBlock,nReps);
+            for(int k=b*sumBlock; k<kEnd; ++k){
+                id0=reps[2*k];
+                id1=reps[2*k+1];
+                u+=repPotential(x[2*id0],x[2*id0+1],x[2*id1],x[2*id1+1],k);
+            }
+            uBlock[b]=u;
+        }
+    });
     double u=0.0;
-    int id0, id1;
-    for(int i=0,j=1,k=0;i<reps.n;i+=2,j+=2,++k){
-        id0=reps[i];
-        id1=reps[j];
-        u+=repPotential(x[2*id0],x[2*id0+1],x[2*id1],x[2*id1+1],k);
-    }
+    for(int b=0; b<nBlocks; ++b) u+=uBlock[b];
     return u;
 }
 
@@ -241,6 +277,33 @@ double BasePotentialModel2D::gcnsPotential(VecF<double> &x) {
 
 //Forces
 void BasePotentialModel2D::bndsForce(VecF<double> &f, VecF<double> &x) {
+    if(nThreads>1){
+        if(!bndsIndexed || bndsStart.n!=x.n/2+1){
+            indexInteractions(bnds,x.n/2,bndsStart,bndsAtom);
+            bndsIndexed=true;
+        }
+        parallelFor(nThreads,0,x.n/2,[&](int a0, int a1, int t){
+            int id0, id1;
+            for(int a=a0; a<a1; ++a){
+                for(int i=bndsStart[a]; i<bndsStart[a+1]; ++i){
+                    int k=bndsAtom[i];
+                    id0=bnds[2*k];
+                    id1=bnds[2*k+1];
+                    double fx0=0.0, fy0=0.0, fx1=0.0, fy1=0.0;
+                    bndForce(x[2*id0],x[2*id0+1],x[2*id1],x[2*id1+1],fx0,fy0,fx1,fy1,k);
+                    if(a==id0){
+                        f[2*a]+=fx0;
+                        f[2*a+1]+=fy0;
+                    }
+                    else{
+                        f[2*a]+=fx1;
+                        f[2*a+1]+=fy1;
+                    }
+                }
+            }
+        });
+        return;
+    }
     int id0, id1;
     for(int i=0,j=1,k=0;i<bnds.n;i+=2,j+=2,++k){
         id0=bnds[i];
@@ -262,6 +325,36 @@ void BasePotentialModel2D::angsForce(VecF<double> &f, VecF<double> &x){
 }
 
 void BasePotentialModel2D::repsForce(VecF<double> &f, VecF<double> &x) {
+    /* Threaded version has each thread own a block of atoms and accumulate only their forces,
+     * visiting repulsions in the same order as the serial loop, so forces do not depend on
+     * the thread count, at the cost of evaluating each repulsion twice */
+    if(nThreads>1){
+        if(!repsIndexed || repsStart.n!=x.n/2+1){
+            indexInteractions(reps,x.n/2,repsStart,repsAtom);
+            repsIndexed=true;
+        }
+        parallelFor(nThreads,0,x.n/2,[&](int a0, int a1, int t){
+            int id0, id1;
+            for(int a=a0; a<a1; ++a){
+                for(int i=repsStart[a]; i<repsStart[a+1]; ++i){
+                    int k=repsAtom[i];
+                    id0=reps[2*k];
+                    id1=reps[2*k+1];
+                    double fx0=0.0, fy0=0.0, fx1=0.0, fy1=0.0;
+                    repForce(x[2*id0],x[2*id0+1],x[2*id1],x[2*id1+1],fx0,fy0,fx1,fy1,k);
+                    if(a==id0){
+                        f[2*a]+=fx0;
+                        f[2*a+1]+=fy0;
+                    }
+                    else{
+                        f[2*a]+=fx1;
+                        f[2*a+1]+=fy1;
+                    }
+                }
+            }
+        });
+        return;
+    }
     int id0, id1;
     for(int i=0,j=1,k=0;i<reps.n;i+=2,j+=2,++k){
         id0=reps[i];
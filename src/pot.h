@@ -4,6 +4,7 @@
 
 #include <iostream>
 #include "opt.h"
+#include "parallel.h"
 
 //Base potential model
 class BasePotentialModel: public FuncGradMultiDim{
@@ -24,6 +25,12 @@ public:
     VecF<double> intP; //intx parameters
     VecF<double> gcnP; //gcns parameters
 
+    //Threading parameters
+    int nThreads; //number of threads for force and energy evaluation
+    int sumBlock; //number of interactions per partial sum, independent of threads
+    bool bndsIndexed,repsIndexed; //flags for up to date atom interaction indices
+    VecF<int> bndsStart,bndsAtom; //bonds involving each atom (compressed by atom)
+    VecF<int> repsStart,repsAtom; //repulsions involving each atom (compressed by atom)
 
     //Constructor, Setters
     BasePotentialModel();
@@ -33,7 +40,9 @@ public:
     void setIntersections(VecF<int> intersections, VecF<double> params);
     void setFixedAtoms(VecF<int> fixed);
     void setGeomConstraints(VecF<int> constrained, VecF<double> params);
+    void setThreads(int threads);
     void reset();
+    void indexInteractions(VecF<int> &pairs, int nAtoms, VecF<int> &start, VecF<int> &atom); //index pairs by atom
 
     //Virtual to define
     double function(VecF<double>& x) override;
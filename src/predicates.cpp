@@ -0,0 +1,122 @@
+#include "predicates.h"
+
+
+//Exact arithmetic on floating point expansions, used when filtered predicates are inconclusive
+typedef vector<double> Expansion;
+
+static const double epsHalf=0.5*numeric_limits<double>::epsilon();
+static const double orientBound=(3.0+16.0*epsHalf)*epsHalf; //error bound on orientation determinant
+static const double powerBound=(12.0+128.0*epsHalf)*epsHalf; //error bound on power test determinant
+
+static inline void twoSum(double a, double b, double &s, double &e) {
+    s=a+b;
+    double bv=s-a;
+    double av=s-bv;
+    e=(a-av)+(b-bv);
+}
+
+static inline Expansion expDiff(double a, double b) {
+    double s,e;
+    twoSum(a,-b,s,e);
+    if(e==0.0) return Expansion{s};
+    return Expansion{e,s};
+}
+
+static Expansion expSum(const Expansion &e, const Expansion &f) {
+    //Grow expansion by each component, eliminating zeros
+    Expansion h=e;
+    for(double b: f){
+        Expansion g;
+        g.reserve(h.size()+1);
+        double q=b;
+        for(double a: h){
+            double s,err;
+            twoSum(q,a,s,err);
+            if(err!=0.0) g.push_back(err);
+            q=s;
+        }
+        g.push_back(q);
+        h.swap(g);
+    }
+    return h;
+}
+
+static Expansion expNeg(Expansion e) {
+    for(double &a: e) a=-a;
+    return e;
+}
+
+static Expansion expProd(const Expansion &e, const Expansion &f) {
+    Expansion h{0.0};
+    for(double a: e){
+        for(double b: f){
+            double p=a*b;
+            double err=fma(a,b,-p);
+            if(err==0.0) h=expSum(h,Expansion{p});
+            else h=expSum(h,Expansion{err,p});
+        }
+    }
+    return h;
+}
+
+static int expSign(const Expansion &e) {
+    for(int i=e.size()-1; i>=0; --i){
+        if(e[i]>0.0) return 1;
+        if(e[i]<0.0) return -1;
+    }
+    return 0;
+}
+
+
+int orient2D(double ax, double ay, double bx, double by, double cx, double cy) {
+    //Positive if anticlockwise, exact sign when floating point result is within error bound
+
+    double acx=ax-cx,bcx=bx-cx;
+    double acy=ay-cy,bcy=by-cy;
+    double l=acx*bcy,r=acy*bcx;
+    double det=l-r;
+    double bound=orientBound*(fabs(l)+fabs(r));
+    if(det>bound) return 1;
+    if(-det>bound) return -1;
+
+    Expansion exact=expSum(expProd(expDiff(ax,cx),expDiff(by,cy)),
+                           expNeg(expProd(expDiff(ay,cy),expDiff(bx,cx))));
+    return expSign(exact);
+}
+
+
+int powerTest(const double px[4], const double py[4], const double pw[4]) {
+    //Positive if fourth point lies within orthocircle of anticlockwise first three, i.e. below plane of lifted points
+    //exact sign when floating point result is within error bound
+
+    double dx[3],dy[3],lift[3],liftAbs[3];
+    for(int i=0; i<3; ++i){
+        dx[i]=px[i]-px[3];
+        dy[i]=py[i]-py[3];
+        lift[i]=dx[i]*dx[i]+dy[i]*dy[i]-(pw[i]-pw[3]);
+        liftAbs[i]=dx[i]*dx[i]+dy[i]*dy[i]+fabs(pw[i])+fabs(pw[3]);
+    }
+    double det=0.0,perm=0.0;
+    for(int i=0; i<3; ++i){
+        int j=(i+1)%3,k=(i+2)%3;
+        det+=lift[i]*(dx[j]*dy[k]-dx[k]*dy[j]);
+        perm+=liftAbs[i]*(fabs(dx[j]*dy[k])+fabs(dx[k]*dy[j]));
+    }
+    double bound=powerBound*perm;
+    if(det>bound) return 1;
+    if(-det>bound) return -1;
+
+    Expansion ex[3],ey[3],el[3];
+    for(int i=0; i<3; ++i){
+        ex[i]=expDiff(px[i],px[3]);
+        ey[i]=expDiff(py[i],py[3]);
+        el[i]=expSum(expSum(expProd(ex[i],ex[i]),expProd(ey[i],ey[i])),expDiff(pw[3],pw[i]));
+    }
+    Expansion exact{0.0};
+    for(int i=0; i<3; ++i){
+        int j=(i+1)%3,k=(i+2)%3;
+        Expansion minor=expSum(expProd(ex[j],ey[k]),expNeg(expProd(ex[k],ey[j])));
+        exact=expSum(exact,expProd(el[i],minor));
+    }
+    return expSign(exact);
+}
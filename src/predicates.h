@@ -0,0 +1,19 @@
+//Robust geometric predicates
+#ifndef NL_PREDICATES_H
+#define NL_PREDICATES_H
+
+#include <vector>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+//Sign of orientation of three points, positive if anticlockwise
+int orient2D(double ax, double ay, double bx, double by, double cx, double cy);
+
+//Sign of power test of fourth point against orthocircle of first three anticlockwise points with weights as squared radii
+//positive if inside, reduces to in-circle test with zero weights
+int powerTest(const double px[4], const double py[4], const double pw[4]);
+
+
+#endif //NL_PREDICATES_H
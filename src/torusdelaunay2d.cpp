@@ -0,0 +1,482 @@
+#include "torusdelaunay2d.h"
+
+
+TorusDelaunay2D::TorusDelaunay2D() {
+    //Default constructor
+
+    n=0;
+    len=0.0;
+    t1Count=0;
+}
+
+
+TorusDelaunay2D::TorusDelaunay2D(double cellLen) {
+    //Construct for square periodic box
+
+    n=0;
+    len=cellLen;
+    t1Count=0;
+    walkSeed=12345;
+}
+
+
+void TorusDelaunay2D::build(VecF<double> &x, VecF<double> &y) {
+    //Triangulate with native periodic tessellation then legalise all edges
+    //exactly cocircular particles can give different diagonals in each periodic copy, so retry with tiny perturbation
+
+    n=x.n;
+    px.assign(x.v,x.v+n);
+    py.assign(y.v,y.v+n);
+    VecF<double> xp(n),yp(n),w(n);
+    w=0.0;
+    double perturb=0.0;
+    for(;;){
+        for(int i=0; i<n; ++i){
+            xp[i]=x[i]+perturb*sin(12.9898*i);
+            yp[i]=y[i]+perturb*sin(78.233*i);
+        }
+        Delaunay2D del(len);
+        del.tessellate(xp,yp,w,n);
+        if(assemble(del)) break;
+        if(perturb==0.0) perturb=1e-12*len;
+        else if(perturb<1e-6*len) perturb*=100.0;
+        else throw string("Periodic triangulation could not be assembled");
+    }
+    beginStep();
+    for(int e=0; e<3*int(triAlive.size()); ++e) flipQueue.push_back(e);
+    legalise();
+    diffAdded.clear();
+    diffRemoved.clear();
+}
+
+
+bool TorusDelaunay2D::assemble(Delaunay2D &del) {
+    //Triangles from cells, one per particle triple with lowest id first
+    //adjacency found by matching each directed edge and image offset with its reverse
+
+    triV.clear();
+    triSx.clear();
+    triSy.clear();
+    triNb.clear();
+    triNbIdx.clear();
+    triAlive.clear();
+    freeTri.clear();
+    flipQueue.clear();
+    vertTri.assign(n,-1);
+    for(int i=0; i<n; ++i){
+        int s=del.cellStart[i];
+        int deg=del.cellStart[i+1]-s;
+        for(int k=0; k<deg; ++k){
+            int k1=s+(k+1)%deg;
+            int a=del.cellNbs[s+k],b=del.cellNbs[k1];
+            if(i>=a || i>=b) continue;
+            int t=newTriangle();
+            setTriangle(t,i,0,0,a,del.cellNbSx[s+k],del.cellNbSy[s+k],b,del.cellNbSx[k1],del.cellNbSy[k1]);
+        }
+    }
+    int nTri=triAlive.size();
+    if(nTri!=2*n) return false;
+    map< tuple<int,int,int,int>, int> edges;
+    for(int t=0; t<nTri; ++t){
+        for(int k=0; k<3; ++k){
+            int k1=3*t+(k+1)%3,k2=3*t+(k+2)%3;
+            edges[make_tuple(triV[k1],triV[k2],triSx[k2]-triSx[k1],triSy[k2]-triSy[k1])]=3*t+k;
+        }
+    }
+    for(int t=0; t<nTri; ++t){
+        for(int k=0; k<3; ++k){
+            int k1=3*t+(k+1)%3,k2=3*t+(k+2)%3;
+            auto it=edges.find(make_tuple(triV[k2],triV[k1],triSx[k1]-triSx[k2],triSy[k1]-triSy[k2]));
+            if(it==edges.end()) return false;
+            triNb[3*t+k]=it->second/3;
+            triNbIdx[3*t+k]=it->second%3;
+        }
+    }
+    for(int i=0; i<n; ++i) if(vertTri[i]<0) return false;
+    return true;
+}
+
+
+void TorusDelaunay2D::move(int p, double xNew, double yNew) {
+    //Keep star and flip if particle stays inside it, otherwise delete and reinsert next to a former neighbour
+
+    beginStep();
+    double dx=xNew-px[p];
+    double dy=yNew-py[p];
+    dx-=len*nearbyint(dx/len);
+    dy-=len*nearbyint(dy/len);
+    double nx=px[p]+dx;
+    double ny=py[p]+dy;
+
+    //Check new position against each edge of link
+    star(p);
+    bool inside=true;
+    for(int s=0; s<int(starTri.size()) && inside; ++s){
+        int t=starTri[s],k=starCorner[s];
+        double ax,ay,bx,by;
+        corner(t,(k+1)%3,ax,ay);
+        corner(t,(k+2)%3,bx,by);
+        double qx=nx+triSx[3*t+k]*len;
+        double qy=ny+triSy[3*t+k]*len;
+        if(orient2D(ax,ay,bx,by,qx,qy)<=0) inside=false;
+    }
+
+    if(inside){
+        px[p]=nx;
+        py[p]=ny;
+        for(int s=0; s<int(starTri.size()); ++s){
+            for(int k=0; k<3; ++k) flipQueue.push_back(3*starTri[s]+k);
+        }
+        legalise();
+    }
+    else{
+        //Former neighbour and its image offset from particle
+        int t=starTri[0],k=starCorner[0];
+        int kq=(k+1)%3;
+        int q=triV[3*t+kq];
+        int relX=triSx[3*t+k]-triSx[3*t+kq];
+        int relY=triSy[3*t+k]-triSy[3*t+kq];
+        remove(p);
+        legalise();
+        px[p]=nx;
+        py[p]=ny;
+        int tq=vertTri[q];
+        int cq=cornerOf(tq,q);
+        insert(p,tq,triSx[3*tq+cq]+relX,triSy[3*tq+cq]+relY);
+        legalise();
+    }
+    endStep(true);
+}
+
+
+void TorusDelaunay2D::swap(int i, int j, double xI, double yI, double xJ, double yJ) {
+    //Remove both particles and reinsert each beside a neighbour of the other's old position
+
+    beginStep();
+    int hint[2];
+    int moved[2]={i,j};
+    for(int m=0; m<2; ++m){
+        star(moved[1-m]);
+        hint[m]=-1;
+        for(int s=0; s<int(starTri.size()) && hint[m]<0; ++s){
+            int v=triV[3*starTri[s]+(starCorner[s]+1)%3];
+            if(v!=i && v!=j) hint[m]=v;
+        }
+    }
+    remove(i);
+    legalise();
+    remove(j);
+    legalise();
+    double xNew[2]={xI,xJ},yNew[2]={yI,yJ};
+    for(int m=0; m<2; ++m){
+        int p=moved[m],q=hint[m];
+        double dx=xNew[m]-px[q];
+        double dy=yNew[m]-py[q];
+        dx-=len*nearbyint(dx/len);
+        dy-=len*nearbyint(dy/len);
+        px[p]=px[q]+dx;
+        py[p]=py[q]+dy;
+        int tq=vertTri[q];
+        int cq=cornerOf(tq,q);
+        insert(p,tq,triSx[3*tq+cq],triSy[3*tq+cq]);
+        legalise();
+    }
+    endStep(false);
+}
+
+
+void TorusDelaunay2D::neighbours(int p, VecR<int> &nbs) {
+    //Neighbours in anticlockwise order
+
+    star(p);
+    nbs=VecR<int>(0,starTri.size());
+    for(int s=0; s<int(starTri.size()); ++s) nbs.addValue(triV[3*starTri[s]+(starCorner[s]+1)%3]);
+}
+
+
+void TorusDelaunay2D::corner(int t, int k, double &cx, double &cy) {
+    //Corner coordinates in triangle frame
+
+    cx=px[triV[3*t+k]]+triSx[3*t+k]*len;
+    cy=py[triV[3*t+k]]+triSy[3*t+k]*len;
+}
+
+
+int TorusDelaunay2D::cornerOf(int t, int v) {
+    //Corner index of particle in triangle
+
+    for(int k=0; k<3; ++k) if(triV[3*t+k]==v) return k;
+    throw string("Particle not in periodic triangle");
+}
+
+
+void TorusDelaunay2D::star(int p) {
+    //Walk anticlockwise round particle, next triangle is across edge after its corner
+
+    starTri.clear();
+    starCorner.clear();
+    int t=vertTri[p];
+    int k=cornerOf(t,p);
+    int t0=t;
+    do{
+        starTri.push_back(t);
+        starCorner.push_back(k);
+        t=triNb[3*t+(k+1)%3];
+        k=cornerOf(t,p);
+    } while(t!=t0);
+}
+
+
+void TorusDelaunay2D::link(int t, int k, int u, int j) {
+    //Set adjacency in both directions
+
+    triNb[3*t+k]=u;
+    triNbIdx[3*t+k]=j;
+    triNb[3*u+j]=t;
+    triNbIdx[3*u+j]=k;
+}
+
+
+void TorusDelaunay2D::setTriangle(int t, int v0, int sx0, int sy0, int v1, int sx1, int sy1, int v2, int sx2, int sy2) {
+    //Set corners, with images relative to first corner so offsets stay small
+
+    triV[3*t]=v0;
+    triV[3*t+1]=v1;
+    triV[3*t+2]=v2;
+    triSx[3*t]=0;
+    triSy[3*t]=0;
+    triSx[3*t+1]=sx1-sx0;
+    triSy[3*t+1]=sy1-sy0;
+    triSx[3*t+2]=sx2-sx0;
+    triSy[3*t+2]=sy2-sy0;
+    vertTri[v0]=t;
+    vertTri[v1]=t;
+    vertTri[v2]=t;
+}
+
+
+int TorusDelaunay2D::newTriangle() {
+    //Reuse free slot or extend
+
+    int t;
+    if(freeTri.size()>0){
+        t=freeTri.back();
+        freeTri.pop_back();
+        triAlive[t]=true;
+    }
+    else{
+        t=triAlive.size();
+        triV.resize(3*t+3);
+        triSx.resize(3*t+3);
+        triSy.resize(3*t+3);
+        triNb.resize(3*t+3,-1);
+        triNbIdx.resize(3*t+3,-1);
+        triAlive.push_back(true);
+    }
+    return t;
+}
+
+
+bool TorusDelaunay2D::locallyDelaunay(int t, int k) {
+    //Opposite particle of neighbour, moved into this frame, must not lie inside circumcircle
+
+    int u=triNb[3*t+k],j=triNbIdx[3*t+k];
+    int k1=(k+1)%3,j2=(j+2)%3;
+    int tx=triSx[3*t+k1]-triSx[3*u+j2];
+    int ty=triSy[3*t+k1]-triSy[3*u+j2];
+    double qx[4],qy[4],qw[4]={0.0,0.0,0.0,0.0};
+    for(int c=0; c<3; ++c) corner(t,c,qx[c],qy[c]);
+    corner(u,j,qx[3],qy[3]);
+    qx[3]+=tx*len;
+    qy[3]+=ty*len;
+    return powerTest(qx,qy,qw)<=0;
+}
+
+
+bool TorusDelaunay2D::flip(int t, int k, bool flatLast) {
+    //Replace edge e1-e2 shared by t=(x,e1,e2) and u=(d,e2,e1) with x-d, giving (x,e1,d) and (x,d,e2)
+
+    int u=triNb[3*t+k],j=triNbIdx[3*t+k];
+    int k1=(k+1)%3,k2=(k+2)%3,j1=(j+1)%3,j2=(j+2)%3;
+    int tx=triSx[3*t+k1]-triSx[3*u+j2];
+    int ty=triSy[3*t+k1]-triSy[3*u+j2];
+    int x=triV[3*t+k],e1=triV[3*t+k1],e2=triV[3*t+k2],d=triV[3*u+j];
+    int xsx=triSx[3*t+k],xsy=triSy[3*t+k];
+    int e1sx=triSx[3*t+k1],e1sy=triSy[3*t+k1];
+    int e2sx=triSx[3*t+k2],e2sy=triSy[3*t+k2];
+    int dsx=triSx[3*u+j]+tx,dsy=triSy[3*u+j]+ty;
+
+    //Quadrilateral must be convex, (x,d,e2) may be flat when e2 is about to be removed
+    double xx,xy,e1x,e1y,e2x,e2y;
+    corner(t,k,xx,xy);
+    corner(t,k1,e1x,e1y);
+    corner(t,k2,e2x,e2y);
+    double dx=px[d]+dsx*len,dy=py[d]+dsy*len;
+    if(orient2D(xx,xy,e1x,e1y,dx,dy)<=0) return false;
+    int o=orient2D(xx,xy,dx,dy,e2x,e2y);
+    if(o<0 || (o==0 && !flatLast)) return false;
+
+    //Outer neighbours, A opposite e1 and B opposite e2 in t, C opposite e2 and D opposite e1 in u
+    int a=triNb[3*t+k1],aIdx=triNbIdx[3*t+k1];
+    int b=triNb[3*t+k2],bIdx=triNbIdx[3*t+k2];
+    int c=triNb[3*u+j1],cIdx=triNbIdx[3*u+j1];
+    int dd=triNb[3*u+j2],dIdx=triNbIdx[3*u+j2];
+
+    setTriangle(t,x,xsx,xsy,e1,e1sx,e1sy,d,dsx,dsy);
+    setTriangle(u,x,xsx,xsy,d,dsx,dsy,e2,e2sx,e2sy);
+    link(t,1,u,2);
+    link(t,0,c,cIdx);
+    link(t,2,b,bIdx);
+    link(u,0,dd,dIdx);
+    link(u,1,a,aIdx);
+
+    recordEdge(e1,e2,-1);
+    recordEdge(x,d,1);
+    flipQueue.push_back(3*t);
+    flipQueue.push_back(3*t+2);
+    flipQueue.push_back(3*u);
+    flipQueue.push_back(3*u+1);
+    ++flips;
+    return true;
+}
+
+
+void TorusDelaunay2D::legalise() {
+    //Lawson flips, each flip queues the four outer edges of its quadrilateral
+
+    while(flipQueue.size()>0){
+        int e=flipQueue.back();
+        flipQueue.pop_back();
+        int t=e/3,k=e%3;
+        if(!triAlive[t]) continue;
+        if(!locallyDelaunay(t,k)) flip(t,k);
+        if(flips>100*n) throw string("Periodic Delaunay repair failed to converge");
+    }
+}
+
+
+void TorusDelaunay2D::remove(int p) {
+    //Flip spokes away until particle has three neighbours, then merge its triangles
+    //particle may lie on new edge, e.g. centre of square of cocircular neighbours, as its triangles are merged away
+
+    for(;;){
+        star(p);
+        if(starTri.size()<=3) break;
+        bool flipped=false;
+        for(int s=0; s<int(starTri.size()) && !flipped; ++s){
+            flipped=flip(starTri[s],(starCorner[s]+1)%3,true);
+        }
+        if(!flipped) throw string("Periodic Delaunay particle removal failed");
+    }
+
+    //Remaining triangles (p,a,b), (p,b,c), (p,c,a) become (a,b,c) in frame of first
+    int t1=starTri[0],t2=starTri[1],t3=starTri[2];
+    int k1=starCorner[0],k2=starCorner[1],k3=starCorner[2];
+    int a=triV[3*t1+(k1+1)%3],b=triV[3*t1+(k1+2)%3],c=triV[3*t2+(k2+2)%3];
+    int asx=triSx[3*t1+(k1+1)%3],asy=triSy[3*t1+(k1+1)%3];
+    int bsx=triSx[3*t1+(k1+2)%3],bsy=triSy[3*t1+(k1+2)%3];
+    int csx=triSx[3*t2+(k2+2)%3]+bsx-triSx[3*t2+(k2+1)%3];
+    int csy=triSy[3*t2+(k2+2)%3]+bsy-triSy[3*t2+(k2+1)%3];
+    int o1=triNb[3*t1+k1],o1Idx=triNbIdx[3*t1+k1];
+    int o2=triNb[3*t2+k2],o2Idx=triNbIdx[3*t2+k2];
+    int o3=triNb[3*t3+k3],o3Idx=triNbIdx[3*t3+k3];
+    triAlive[t2]=false;
+    triAlive[t3]=false;
+    freeTri.push_back(t2);
+    freeTri.push_back(t3);
+    setTriangle(t1,a,asx,asy,b,bsx,bsy,c,csx,csy);
+    link(t1,0,o2,o2Idx);
+    link(t1,1,o3,o3Idx);
+    link(t1,2,o1,o1Idx);
+    vertTri[p]=-1;
+    recordEdge(p,a,-1);
+    recordEdge(p,b,-1);
+    recordEdge(p,c,-1);
+    for(int k=0; k<3; ++k) flipQueue.push_back(3*t1+k);
+}
+
+
+void TorusDelaunay2D::insert(int p, int t, int sx, int sy) {
+    //Walk to containing triangle, carrying particle image into each frame, then split into three
+
+    for(;;){
+        double qx=px[p]+sx*len,qy=py[p]+sy*len;
+        walkSeed=walkSeed*1103515245u+12345u;
+        int r=(walkSeed>>16)%3;
+        bool moved=false;
+        for(int e=0; e<3 && !moved; ++e){
+            int i=(r+e)%3;
+            double ax,ay,bx,by;
+            corner(t,(i+1)%3,ax,ay);
+            corner(t,(i+2)%3,bx,by);
+            if(orient2D(ax,ay,bx,by,qx,qy)<0){
+                int u=triNb[3*t+i],j=triNbIdx[3*t+i];
+                sx-=triSx[3*t+(i+1)%3]-triSx[3*u+(j+2)%3];
+                sy-=triSy[3*t+(i+1)%3]-triSy[3*u+(j+2)%3];
+                t=u;
+                moved=true;
+            }
+        }
+        if(!moved) break;
+    }
+
+    //Split (a,b,c) into (a,b,p), (b,c,p), (c,a,p)
+    int a=triV[3*t],b=triV[3*t+1],c=triV[3*t+2];
+    int asx=triSx[3*t],asy=triSy[3*t];
+    int bsx=triSx[3*t+1],bsy=triSy[3*t+1];
+    int csx=triSx[3*t+2],csy=triSy[3*t+2];
+    int oa=triNb[3*t],oaIdx=triNbIdx[3*t];
+    int ob=triNb[3*t+1],obIdx=triNbIdx[3*t+1];
+    int oc=triNb[3*t+2],ocIdx=triNbIdx[3*t+2];
+    int t0=t;
+    int t1=newTriangle();
+    int t2=newTriangle();
+    setTriangle(t0,a,asx,asy,b,bsx,bsy,p,sx,sy);
+    setTriangle(t1,b,bsx,bsy,c,csx,csy,p,sx,sy);
+    setTriangle(t2,c,csx,csy,a,asx,asy,p,sx,sy);
+    link(t0,2,oc,ocIdx);
+    link(t1,2,oa,oaIdx);
+    link(t2,2,ob,obIdx);
+    link(t0,0,t1,1);
+    link(t0,1,t2,0);
+    link(t1,0,t2,1);
+    recordEdge(p,a,1);
+    recordEdge(p,b,1);
+    recordEdge(p,c,1);
+    flipQueue.push_back(3*t0+2);
+    flipQueue.push_back(3*t1+2);
+    flipQueue.push_back(3*t2+2);
+}
+
+
+void TorusDelaunay2D::recordEdge(int a, int b, int change) {
+    //Store edge change with lower id first
+
+    if(a<b) edgeChanges.push_back(make_tuple(a,b,change));
+    else edgeChanges.push_back(make_tuple(b,a,change));
+}
+
+
+void TorusDelaunay2D::beginStep() {
+    //Clear changes for new step
+
+    edgeChanges.clear();
+    flips=0;
+}
+
+
+void TorusDelaunay2D::endStep(bool t1) {
+    //Net change in each edge, flips undone within step cancel
+
+    diffAdded.clear();
+    diffRemoved.clear();
+    sort(edgeChanges.begin(),edgeChanges.end());
+    for(int i=0; i<int(edgeChanges.size());){
+        int a=get<0>(edgeChanges[i]),b=get<1>(edgeChanges[i]);
+        int net=0;
+        for(; i<int(edgeChanges.size()) && get<0>(edgeChanges[i])==a && get<1>(edgeChanges[i])==b; ++i) net+=get<2>(edgeChanges[i]);
+        if(net>0) diffAdded.push_back(make_pair(a,b));
+        else if(net<0) diffRemoved.push_back(make_pair(a,b));
+    }
+    if(t1) t1Count+=diffRemoved.size();
+}
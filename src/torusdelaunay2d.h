@@ -0,0 +1,74 @@
+#ifndef HDMC_TORUSDELAUNAY2D_H
+#define HDMC_TORUSDELAUNAY2D_H
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <algorithm>
+#include <cmath>
+#include "vecf.h"
+#include "vecr.h"
+#include "predicates.h"
+#include "delaunay2d.h"
+
+using namespace std;
+
+class TorusDelaunay2D {
+    //Delaunay triangulation of square periodic box maintained through particle moves by local repair
+    //triangles hold the periodic image of each corner, so particle coordinates are kept unwrapped
+
+private:
+
+    //Data members
+    vector<double> px,py; //unwrapped particle coordinates
+    vector<int> triV; //triangle vertices anticlockwise
+    vector<int> triSx,triSy; //periodic image of each corner in box lengths
+    vector<int> triNb,triNbIdx; //neighbour opposite each corner and its corner opposite shared edge
+    vector<char> triAlive; //triangle in use
+    vector<int> freeTri; //unused triangle slots
+    vector<int> vertTri; //a triangle containing each particle
+    vector<int> flipQueue; //edges to check, as 3*triangle+corner
+    vector<int> starTri,starCorner; //triangles round particle and its corner in each
+    vector< tuple<int,int,int> > edgeChanges; //edges added (+1) and removed (-1) during current step
+    int flips; //flips during current step
+    unsigned int walkSeed; //generator for walk start edge
+
+    //Member functions
+    bool assemble(Delaunay2D &del); //triangles and adjacency from tessellation, false if inconsistent
+    void corner(int t, int k, double &cx, double &cy); //coordinates of corner in frame of triangle
+    int cornerOf(int t, int v); //corner of particle in triangle
+    void star(int p); //triangles round particle anticlockwise
+    void link(int t, int k, int u, int j); //make triangles adjacent across edges opposite corners
+    void setTriangle(int t, int v0, int sx0, int sy0, int v1, int sx1, int sy1, int v2, int sx2, int sy2);
+    int newTriangle();
+    bool locallyDelaunay(int t, int k); //edge opposite corner passes in-circle test
+    bool flip(int t, int k, bool flatLast=false); //flip edge opposite corner if quadrilateral is convex, optionally allowing second triangle to be flat
+    void legalise(); //Lawson flips until no queued edge fails
+    void remove(int p); //remove particle by flipping down to three neighbours
+    void insert(int p, int t, int sx, int sy); //insert particle at its coordinates in given image of start triangle frame
+    void recordEdge(int a, int b, int change);
+    void beginStep();
+    void endStep(bool t1);
+
+public:
+
+    //Data members
+    int n; //number of particles
+    double len; //periodic box length
+    long t1Count; //accumulated T1 events, i.e. net Delaunay edge flips from translation moves
+    vector< pair<int,int> > diffAdded,diffRemoved; //net change in neighbour pairs from last move
+
+    //Constructors
+    TorusDelaunay2D();
+    TorusDelaunay2D(double cellLen);
+
+    //Member functions
+    void build(VecF<double> &x, VecF<double> &y); //triangulate from scratch
+    void move(int p, double xNew, double yNew); //update after particle translation
+    void swap(int i, int j, double xI, double yI, double xJ, double yJ); //update after particles exchange positions
+    void neighbours(int p, VecR<int> &nbs); //current neighbours of particle anticlockwise
+};
+
+
+#endif //HDMC_TORUSDELAUNAY2D_H
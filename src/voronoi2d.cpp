@@ -1,53 +1,117 @@
 #include "voronoi2d.h"
 
 
-Voronoi2D::Voronoi2D(VecF<double> &x, VecF<double> &y, VecF<double> &w, double cellLen_2, int numA, bool rad, VecF<bool> radInc, int maxV) {
-    //Initialise with x,y coordinates and radii
+Voronoi2D::Voronoi2D() {
+    //Default constructor
 
-    //Make periodic container in xy
-    n=x.n;
-    nA=numA;
-    nB=n-nA;
-    int blocks=sqrt(n);
+    n=0;
+    nMax=0;
+    nStrips=0;
+}
+
+
+Voronoi2D::Voronoi2D(double cellLen_2, int num, double rMax, int maxV, bool nat) {
+    //Initialise periodic box and cell buffers once, to be refilled for each configuration
+
+    n=0;
+    nA=0;
+    nB=0;
+    nMax=num;
+    maxVertices=maxV;
     dz=cellLen_2*2;
     pbc=cellLen_2*2;
     rpbc=1.0/pbc;
+    native=nat;
+    wMax=rMax;
+    nStrips=0;
+
+    //Flat geometry store at full size, included particles use leading entries
+    cellStart=VecF<int>(nMax);
+    cellSize=VecF<int>(nMax);
+    cellNbs=VecF<int>(nMax*maxV);
+    cellEdges=VecF<double>(nMax*maxV);
+    cellRings=VecF<double>(2*nMax*maxV);
+    cellAreas=VecF<double>(nMax);
+    cellPerimeters=VecF<double>(nMax);
+    idMap=VecF<int>(nMax);
+    stripOf=VecF<int>(nMax);
+
+    //Native engine triangulates directly in 2D
+    if(native){
+        del=Delaunay2D(pbc);
+        return;
+    }
+
+    //Make periodic container in xy
+#ifdef HDMC_USE_VORO
+    int blocks=blocksPerSide(pbc,nMax,rMax);
     con=make_shared<voro::container_poly>(-cellLen_2,cellLen_2,-cellLen_2,cellLen_2,-cellLen_2,cellLen_2,
-            blocks,blocks,1,true,true,false,n);
+            blocks,blocks,1,true,true,false,max(8,2*nMax/(blocks*blocks)));
+#else
+    throw string("Voronoi analysis with voro++ engine requires build with HDMC_USE_VORO");
+#endif
+}
+
+
+Voronoi2D::Voronoi2D(VecF<double> &x, VecF<double> &y, VecF<double> &w, double cellLen_2, int numA, bool rad, VecF<bool> radInc, int maxV, bool nat) :
+        Voronoi2D(cellLen_2,x.n,vMaximum(w),maxV,nat) {
+    //Initialise with x,y coordinates and radii for single configuration
+
+    compute(x,y,w,numA,rad,radInc);
+}
+
+
+int Voronoi2D::blocksPerSide(double cellLen, int num, double rMax) {
+    //Aim for around five particles per block, as blocks much smaller than the largest particle only add to search
 
-    //Add particles and weights if radical
+    double blockLen=max(sqrt(5.0*cellLen*cellLen/num),2.0*rMax);
+    return max(1,int(cellLen/blockLen));
+}
+
+
+void Voronoi2D::compute(VecF<double> &x, VecF<double> &y, VecF<double> &w, int numA, bool rad, VecF<bool> &radInc, int nThreads) {
+    //Tessellate configuration, reusing container and buffers
+
+    n=x.n;
+    nA=numA;
+    nB=n-nA;
     radical=rad;
-    if(rad){
-        //Only use included particles, recalculating number of particles
-        int niA=0,ni=0;
-        for(int i=0; i<nA; ++i){
-            if(radInc[i]){
-                con->put(niA,x[i],y[i],0.0,w[i]);
-                idMap[niA]=i;
-                ++niA;
-            }
-        }
-        ni=niA;
-        for(int i=nA; i<n; ++i){
-            if(radInc[i]){
-                con->put(i,x[i],y[i],0.0,w[i]);
-                idMap[ni]=i;
-                ++ni;
-            }
-        }
-        nA=niA;
-        n=ni;
-        nB=n-niA;
+    if(n>nMax) throw string("Voronoi configuration larger than initialised buffers");
+
+    //Included particles, as ids of tessellation with type A first, recalculating number of particles
+    int niA=0;
+    for(int i=0; i<nA; ++i) if(!radical || radInc[i]) idMap[niA++]=i;
+    int ni=niA;
+    for(int i=nA; i<n; ++i) if(!radical || radInc[i]) idMap[ni++]=i;
+    nA=niA;
+    n=ni;
+    nB=n-niA;
+    if(xi.n!=n){
+        xi=VecF<double>(n);
+        yi=VecF<double>(n);
+        wi=VecF<double>(n);
     }
-    else{
-        for(int i=0; i<n; ++i){
-            con->put(i,x[i],y[i],0.0,0.0);
-            idMap[i]=i;
-        }
+    for(int i=0; i<n; ++i){
+        int origId=idMap[i];
+        xi[i]=x[origId];
+        yi[i]=y[origId];
+        wi[i]=0.0;
+        if(radical) wi[i]=w[origId];
+    }
+
+    //Native engine triangulates directly in 2D
+    if(native){
+        computeCellsNative();
+        return;
     }
 
-    //Calculate cells
-    computeCells(x,y,w,maxV);
+    //Concurrent strips where box is wide enough, otherwise single periodic container
+#ifdef HDMC_USE_VORO
+    if(nThreads>1 && computeCellsStrips(nThreads)) return;
+    con->clear();
+    for(int i=0; i<n; ++i) con->put(i,xi[i],yi[i],0.0,wi[i]);
+    computeCells();
+#endif
 }
 
 
@@ -58,7 +122,7 @@ void Voronoi2D::analyse(int maxSize, VecF<int> &cellSizeDistA, VecF<int> &cellSi
     //Calculate cell sizes and size distribution
     VecF<int> cellSizes(n);
     for(int i=0; i<n; ++i){
-        cellSizes[i]=cellNbs[i].n;
+        cellSizes[i]=cellSize[i];
     }
     cellSizeDistA=VecF<int>(maxSize);
     cellSizeDistB=VecF<int>(maxSize);
@@ -70,12 +134,11 @@ void Voronoi2D::analyse(int maxSize, VecF<int> &cellSizeDistA, VecF<int> &cellSi
     for(int i=0; i<maxSize; ++i) cellAdjDist[i]=VecF<int>(maxSize);
     for(int i=0; i<n; ++i){
         int sizeI=cellSizes[i];
-        for(int j=0; j<cellNbs[i].n; ++j){
-//            cout<<cellNbs[i][j]<<" "<<cellSizes[cellNbs[i][j]]<<endl;
-            int sizeJ=cellSizes[cellNbs[i][j]];
+        for(int j=cellStart[i]; j<cellStart[i]+cellSize[i]; ++j){
+            int sizeJ=cellSizes[cellNbs[j]];
             ++cellAdjDist[sizeI][sizeJ];
             //Account for self interactions
-            if(i==cellNbs[i][j]) ++cellAdjDist[sizeI][sizeJ];
+            if(i==cellNbs[j]) ++cellAdjDist[sizeI][sizeJ];
         }
     }
 
@@ -113,120 +176,282 @@ void Voronoi2D::nnDistances(VecF<double> &x, VecF<double> &y, double cellLen, do
     for(int i=nA; i<n; ++i) nType[i]=1;
     double dx,dy,d;
     for(int i=0; i<n; ++i){
-        for(int j=0; j<cellNbs[i].n; ++j){
-            dx=x[i]-x[cellNbs[i][j]];
-            dy=y[i]-y[cellNbs[i][j]];
+        for(int j=cellStart[i]; j<cellStart[i]+cellSize[i]; ++j){
+            dx=x[i]-x[cellNbs[j]];
+            dy=y[i]-y[cellNbs[j]];
             dx-=cellLen*nearbyint(dx*rCellLen);
             dy-=cellLen*nearbyint(dy*rCellLen);
             d=sqrt(dx*dx+dy*dy);
-            ++nnCount[nType[i]+nType[cellNbs[i][j]]];
-            nnSep[nType[i]+nType[cellNbs[i][j]]]+=d;
+            ++nnCount[nType[i]+nType[cellNbs[j]]];
+            nnSep[nType[i]+nType[cellNbs[j]]]+=d;
         }
     }
 }
 
 
-void Voronoi2D::computeCells(VecF<double> &x, VecF<double> &y, VecF<double> &w, int maxV) {
-    //Calculate neighbouring particles for each particle, and area of cells
+#ifdef HDMC_USE_VORO
+double Voronoi2D::storeCell(voro::voronoicell_neighbor &cell, int id, double px, double py, double pz, int &k, CellScratch &scr) {
+    //Side faces give neighbours and shared edges, top face gives ring
+    //store is filled from k onwards
+
+    cell.neighbors(scr.nbs);
+    cell.face_areas(scr.faceAreas);
+    cell.face_orders(scr.faceSizes);
+    cell.normals(scr.normals);
+    cell.face_vertices(scr.vertexIds);
+    cell.vertices(px,py,pz,scr.vertexCrds);
+    cellStart[id]=k;
+    cellPerimeters[id]=0.0;
+    double ringRSq=0.0;
+    int ringK=k,v=0;
+    for(int i=0; i<int(scr.nbs.size()); ++i){
+        if(scr.nbs[i]==-5 || scr.nbs[i]==-6){
+            if(fabs(scr.normals[3*i+2]-1)<1e-12){
+                for(int j=1; j<=scr.faceSizes[i]; ++j){
+                    double vx=scr.vertexCrds[3*scr.vertexIds[v+j]];
+                    double vy=scr.vertexCrds[3*scr.vertexIds[v+j]+1];
+                    cellRings[2*ringK]=vx;
+                    cellRings[2*ringK+1]=vy;
+                    ringRSq=max(ringRSq,(vx-px)*(vx-px)+(vy-py)*(vy-py));
+                    ++ringK;
+                }
+            }
+        }
+        else{
+            if(k-cellStart[id]==maxVertices) throw string("Voronoi cell exceeds maximum vertices");
+            if(scr.nbs[i]<0) cellNbs[k]=id; //add self interaction
+            else cellNbs[k]=scr.nbs[i];
+            cellEdges[k]=scr.faceAreas[i]/dz;
+            cellPerimeters[id]+=cellEdges[k];
+            ++k;
+        }
+        v+=scr.faceSizes[i]+1;
+    }
+
+    //Start ring at vertex of lowest polar angle about particle, as face order depends on container
+    int first=cellStart[id];
+    double angleMin=numeric_limits<double>::infinity();
+    for(int j=cellStart[id]; j<ringK; ++j){
+        double angle=atan2(cellRings[2*j+1]-py,cellRings[2*j]-px);
+        if(angle<angleMin){
+            angleMin=angle;
+            first=j;
+        }
+    }
+    rotate(cellRings.v+2*cellStart[id],cellRings.v+2*first,cellRings.v+2*ringK);
+
+    cellSize[id]=k-cellStart[id];
+    cellAreas[id]=cell.volume()/dz;
+    return ringRSq;
+}
+
+
+void Voronoi2D::hideCell(int id, int k) {
+    //Cell removed entirely by neighbouring weights has no neighbours or area
+
+    cellStart[id]=k;
+    cellSize[id]=0;
+    cellAreas[id]=0.0;
+    cellPerimeters[id]=0.0;
+}
+
+
+void Voronoi2D::computeCells() {
+    //Calculate neighbours, shared edges, area, perimeter and ring of each cell in single pass
 
     //Make looper
     voro::c_loop_all looper(*con);
     looper.start();
 
-    //Resize neighbour vectors
-    cellNbs=VecF< VecR<int> >(n);
-    for(int i=0; i<n; ++i) cellNbs[i]=VecR<int>(0,maxV);
-    cellAreas=VecF<double>(n);
-
-    //Loop over each cell and extract neighbour ids
+    //Loop over each cell, appending to flat store in container order
+    voro::voronoicell_neighbor cell;
+    CellScratch scr;
+    int k=0;
     do{
         int id=looper.pid(); //central id
-        voro::voronoicell_neighbor cell;
-        con->compute_cell(cell,looper);
-        vector<int> nbs;
-        cell.neighbors(nbs);
-        for(int i=0; i<nbs.size(); ++i){
-            cellNbs[id].addValue(nbs[i]);
-        }
-        cellNbs[id].delValue(-5); //remove z cell boundary
-        cellNbs[id].delValue(-6); //remove z cell boundary
-        for(int i=0; i<cellNbs[id].n; ++i) if(cellNbs[id][i]<0) cellNbs[id][i]=id; //add self interaction
-        cellAreas[id]=cell.volume()/dz;
+        double px,py,pz;
+        looper.pos(px,py,pz);
+        if(con->compute_cell(cell,looper)) storeCell(cell,id,px,py,pz,k,scr);
+        else hideCell(id,k);
     } while(looper.inc());
 }
 
 
-void Voronoi2D::getRings(VecF<double> &x, VecF<double> &y, VecF< VecR<double> > &rings) {
-    //Find rings as vertex coordinates
+void Voronoi2D::makeStrip(int s) {
+    //Container spanning strip and its halo, periodic in y only
 
-    //Make looper
-    voro::c_loop_all looper(*con);
-    looper.start();
+    double width=pbc/nStrips;
+    double x0=-0.5*pbc+s*width-stripHalo[s];
+    double x1=-0.5*pbc+(s+1)*width+stripHalo[s];
+    int blocks=blocksPerSide(pbc,nMax,wMax);
+    int blocksX=max(1,int(blocks*(x1-x0)/pbc));
+    stripCon[s]=make_shared<voro::container_poly>(x0,x1,-0.5*pbc,0.5*pbc,-0.5*pbc,0.5*pbc,
+            blocksX,blocks,1,false,true,false,max(8,2*nMax/(blocks*blocks)));
+}
 
-    //Resize vectors
-    rings=VecF< VecR<double> >(cellNbs.n);
-    for(int i=0; i<cellNbs.n; ++i) rings[i]=VecR<double>(0,2*(cellNbs[i].n+1));
 
-    //Loop over each cell and extract rings
-    do{
-        int id=looper.pid(); //central id
-        int origId=idMap.at(id); //corresponding original id
-        //check that cell has non-zero neighbours (radical with full overlap)
-        if(cellNbs[id].n>0) {
-            voro::voronoicell_neighbor cell;
-            con->compute_cell(cell, looper);
-            //Find faces, normals and vertices
-            vector<int> faceSizes; //number of vertices in each face
-            cell.face_orders(faceSizes);
-            int numFaces = faceSizes.size(); //number of faces
-            vector<double> normals; //normals for each face (x,y,z)
-            cell.normals(normals);
-            int keyFace = -1; //id of face of interest
-            for (int i = 0; i < numFaces; ++i) {
-                if (fabs(normals[3 * i + 2] - 1) < 1e-12) {
-                    keyFace = i;
-                    break;
+bool Voronoi2D::computeCellsStrips(int nThreads) {
+    //Calculate cells by strips in x, each with own container holding ghost images within halo
+    //a cell is exact if no particle beyond halo could cut it, otherwise halo is widened and strip repeated
+
+    //Set up strips on first use, halo of several particle spacings
+    if(nStrips!=nThreads){
+        nStrips=nThreads;
+        stripCon=vector< shared_ptr<voro::container_poly> >(nStrips);
+        stripHalo=VecF<double>(nStrips);
+        stripHalo=4.0*pbc/sqrt(double(nMax))+wMax;
+        for(int s=0; s<nStrips; ++s) makeStrip(s);
+    }
+    double width=pbc/nStrips;
+    if(width+2.0*vMaximum(stripHalo)>=pbc) return false;
+
+    //Owning strip of each particle, with region of store proportional to number owned
+    VecF<int> stripBase(nStrips+1);
+    for(int i=0; i<n; ++i){
+        stripOf[i]=min(nStrips-1,int((xi[i]+0.5*pbc)/width));
+        ++stripBase[stripOf[i]+1];
+    }
+    for(int s=0; s<nStrips; ++s) stripBase[s+1]+=stripBase[s];
+
+    //Tessellate strips concurrently
+    VecF<bool> fallback(nStrips);
+    vector<string> errors(nStrips);
+    parallelFor(nThreads,0,nStrips,[&](int s0, int s1, int t){
+        voro::voronoicell_neighbor cell;
+        CellScratch scr;
+        for(int s=s0; s<s1; ++s){
+            double xc=-0.5*pbc+(s+0.5)*width;
+            for(;;){
+                //Particles and periodic images within halo, placed once as halo is less than half box
+                double reach=0.5*width+stripHalo[s];
+                voro::container_poly &sCon=*stripCon[s];
+                sCon.clear();
+                for(int i=0; i<n; ++i){
+                    double xs=xi[i]-pbc*nearbyint((xi[i]-xc)*rpbc);
+                    if(fabs(xs-xc)<=reach) sCon.put(i,xs,yi[i],0.0,wi[i]);
                 }
-            }
-            vector<int> vertexIds; //ids of vertices that make up faces
-            cell.face_vertices(vertexIds);
-            vector<double> vertexCrds; //coordinates of vertices
-            cell.vertices(vertexCrds);
-            cell.vertices(x[origId], y[origId], 0.0, vertexCrds);
-            //Extract vertices for face
-            VecR<int> keyVertexIds(0, 100);
-            int k = 0;
-            for (int i = 0; i < numFaces; ++i) {
-                if (i == keyFace) {
-                    for (int j = 0; j < faceSizes[i] + 1; ++j) {
-                        keyVertexIds.addValue(vertexIds[k]);
-                        ++k;
+
+                //Owned cells, exact if wall is beyond furthest possible cutting particle
+                bool exact=true;
+                int k=maxVertices*stripBase[s];
+                voro::c_loop_all looper(sCon);
+                if(looper.start()) do{
+                    int id=looper.pid();
+                    if(stripOf[id]!=s) continue;
+                    double px,py,pz;
+                    looper.pos(px,py,pz);
+                    if(!sCon.compute_cell(cell,looper)){
+                        hideCell(id,k);
+                        continue;
+                    }
+                    double rSq;
+                    try{
+                        rSq=storeCell(cell,id,px,py,pz,k,scr);
+                    }
+                    catch(string &e){
+                        errors[s]=e;
+                        return;
+                    }
+                    double wall=reach-fabs(px-xc);
+                    double reqd=sqrt(rSq)+sqrt(rSq+wMax*wMax);
+                    if(wall<=reqd){
+                        exact=false;
+                        break;
                     }
+                } while(looper.inc());
+                if(exact) break;
+
+                //Widen halo, unless strip and halo would cover box
+                stripHalo[s]*=1.5;
+                if(width+2.0*stripHalo[s]>=pbc){
+                    fallback[s]=true;
                     break;
-                } else k += faceSizes[i] + 1;
-            }
-            for (int i = 1; i < keyVertexIds.n; ++i) {//first index gives face size
-                rings[id].addValue(vertexCrds[3 * keyVertexIds[i]]);
-                rings[id].addValue(vertexCrds[3 * keyVertexIds[i] + 1]);
+                }
+                makeStrip(s);
             }
         }
+    });
+    for(int s=0; s<nStrips; ++s) if(errors[s]!="") throw errors[s];
+    return vSum(fallback)==0;
+}
+#endif
+
+
+void Voronoi2D::computeCellsNative() {
+    //Calculate neighbours, shared edges, areas and rings from periodic power diagram
+    //radical includes particles as for voro++ with weights as squared radii
+
+    //Tessellate and copy cells, already in flat form
+    for(int i=0; i<n; ++i) wi[i]*=wi[i];
+    del.tessellate(xi,yi,wi,maxVertices);
+    for(int i=0; i<n; ++i){
+        cellStart[i]=del.cellStart[i];
+        cellSize[i]=del.cellStart[i+1]-del.cellStart[i];
+        cellPerimeters[i]=0.0;
+        for(int k=del.cellStart[i]; k<del.cellStart[i+1]; ++k){
+            cellNbs[k]=del.cellNbs[k];
+            cellEdges[k]=del.cellEdges[k];
+            cellRings[2*k]=del.cellVx[k];
+            cellRings[2*k+1]=del.cellVy[k];
+            cellPerimeters[i]+=del.cellEdges[k];
+        }
+        cellAreas[i]=del.cellAreas[i];
+    }
+}
+
+
+void Voronoi2D::getRings(VecF<double> &x, VecF<double> &y, VecF< VecR<double> > &rings) {
+    //Find rings as vertex coordinates from geometry store, placeholder for hidden cells
+
+    rings=VecF< VecR<double> >(n);
+    for(int id=0; id<n; ++id){
+        if(cellSize[id]>0){
+            rings[id]=VecR<double>(0,2*cellSize[id]);
+            for(int k=2*cellStart[id]; k<2*(cellStart[id]+cellSize[id]); ++k) rings[id].addValue(cellRings[k]);
+        }
         else{
-            //Add placeholder ring
+            int origId=idMap[id];
             rings[id]=VecR<double>(0,6);
             for(int i=0; i<3; ++i){
-                rings[id].addValue(x[id]);
-                rings[id].addValue(y[id]);
+                rings[id].addValue(x[origId]);
+                rings[id].addValue(y[origId]);
             }
         }
-    } while(looper.inc());
+    }
 }
 
 
-void Voronoi2D::getAreas(VecF<int> &areaHist, double adfDelta) {
+void Voronoi2D::getAreas(AreaHistogram &areaHist) {
     //Add areas of each cell to histogram
 
+    for(int i=0; i<n; ++i) areaHist.add(cellAreas[i]);
+}
+
+void Voronoi2D::bondOrder(VecF<double> &x, VecF<double> &y, double cellLen, double rCellLen, VecF< complex<double> > &psi, VecF< complex<double> > &psiW) {
+    //Calculate hexatic bond orientational order of each particle, plain and weighted by shared edge length
+
+    psi=VecF< complex<double> >(n);
+    psiW=VecF< complex<double> >(n);
     for(int i=0; i<n; ++i){
-        int b = floor(cellAreas[i]/adfDelta);
-        ++areaHist[b];
+        complex<double> sum(0.0,0.0),sumW(0.0,0.0);
+        double edgeSum=0.0;
+        int count=0;
+        for(int j=cellStart[i]; j<cellStart[i]+cellSize[i]; ++j){
+            int nb=cellNbs[j];
+            if(nb==i) continue;
+            double dx=x[nb]-x[i];
+            double dy=y[nb]-y[i];
+            dx-=cellLen*nearbyint(dx*rCellLen);
+            dy-=cellLen*nearbyint(dy*rCellLen);
+            complex<double> bond=complex<double>(dx,dy)/sqrt(dx*dx+dy*dy);
+            complex<double> bond2=bond*bond;
+            complex<double> bond6=bond2*bond2*bond2; //exp(6i theta)
+            sum+=bond6;
+            sumW+=cellEdges[j]*bond6;
+            edgeSum+=cellEdges[j];
+            ++count;
+        }
+        if(count>0) psi[i]=sum/double(count);
+        if(edgeSum>0.0) psiW[i]=sumW/edgeSum;
     }
-}
\ No newline at end of file
+}
@@ -7,43 +7,86 @@
 #include <iomanip>
 #include <vector>
 #include <memory>
-#include <map>
+#include <complex>
+#include <algorithm>
+#include <limits>
 #include "outputfile.h"
 #include "vecf.h"
 #include "vecr.h"
 #include "vec_func.h"
-#include "../voro++/src/voro++.hh"
+#include "delaunay2d.h"
+#include "parallel.h"
+#include "areahistogram.h"
+#ifdef HDMC_USE_VORO
+#include "voro++.hh"
+#endif
 
 using namespace std;
 
 class Voronoi2D {
-    //Voronoi analysis of 2D system using Voro++
+    //Voronoi analysis of 2D system using Voro++ or native periodic Delaunay
 
 private:
 
     //Data members
+#ifdef HDMC_USE_VORO
     shared_ptr<voro::container_poly> con;
+#endif
     int n,nA,nB; //total number of particles and of type A, B
+    int nMax; //number of particles buffers are sized for
+    int maxVertices; //maximum number of vertices per cell
     double dz; //height of cells
     double pbc,rpbc; //periodic boundary conditions
-    VecF< VecR<int> > cellNbs; //neighbours of each cell
-    VecF<double> cellAreas; //areas of each cell
     bool radical; //flag for radical tessellation
-    map<int,int> idMap; //map included ids to orignal ids
+    bool native; //flag for native periodic Delaunay engine
+    //Flat cell geometry, computed once per configuration
+    VecF<int> cellStart,cellSize; //offset of each cell into flat store and its number of neighbours
+    VecF<int> cellNbs; //neighbour ids
+    VecF<double> cellEdges; //length of edge shared with each neighbour
+    VecF<double> cellRings; //ring vertex x,y coordinates, one vertex per neighbour
+    VecF<double> cellAreas,cellPerimeters; //area and perimeter of each cell
+    VecF<int> idMap; //map included ids to orignal ids
+    Delaunay2D del; //native engine triangulation
+    VecF<double> xi,yi,wi; //included coordinates and weights
+    double wMax; //largest weight
+    int nStrips; //strips for concurrent tessellation, 0 if not set up
+#ifdef HDMC_USE_VORO
+    vector< shared_ptr<voro::container_poly> > stripCon; //container for each strip and its ghost halo
+#endif
+    VecF<double> stripHalo; //ghost halo width of each strip
+    VecF<int> stripOf; //strip owning each particle
+
+    //Scratch space for extracting cell
+    struct CellScratch {
+        vector<int> nbs,faceSizes,vertexIds;
+        vector<double> faceAreas,normals,vertexCrds;
+    };
 
     //Member functions
-    void computeCells(VecF<double> &x, VecF<double> &y, VecF<double> &w, int maxV); //find neighbours for each cell
+    static int blocksPerSide(double cellLen, int num, double rMax); //container blocks along each side
+#ifdef HDMC_USE_VORO
+    double storeCell(voro::voronoicell_neighbor &cell, int id, double px, double py, double pz, int &k, CellScratch &scr); //add cell to geometry store, returning squared ring radius
+    void hideCell(int id, int k); //empty cell in geometry store
+    void computeCells(); //find neighbours for each cell
+    void makeStrip(int s); //container for strip and its halo
+    bool computeCellsStrips(int nThreads); //find neighbours for each cell concurrently by strips, false if strips too narrow
+#endif
+    void computeCellsNative(); //neighbours and rings from power diagram
 
 public:
 
-    //Constructor
-    Voronoi2D(VecF<double> &x, VecF<double> &y, VecF<double> &w, double cellLen_2, int numA, bool rad, VecF<bool> radInc, int maxV); //2D coordinates and weights, cell info
+    //Constructors
+    Voronoi2D();
+    Voronoi2D(double cellLen_2, int num, double rMax, int maxV, bool nat=false); //box and buffers, reused for each configuration
+    Voronoi2D(VecF<double> &x, VecF<double> &y, VecF<double> &w, double cellLen_2, int numA, bool rad, VecF<bool> radInc, int maxV, bool nat=false); //2D coordinates and weights, cell info
 
     //Member functions
+    void compute(VecF<double> &x, VecF<double> &y, VecF<double> &w, int numA, bool rad, VecF<bool> &radInc, int nThreads=1); //clear and tessellate configuration
     void analyse(int maxSize, VecF<int> &cellSizeDistA, VecF<int> &cellSizeDistB, VecF< VecF<int> > &cellAdjDist, VecF<double> &cellAreaA, VecF<double> &cellAreaB);
     void nnDistances(VecF<double> &x, VecF<double> &y, double cellLen, double rCellLen, VecF<double> &nnSep, VecF<int> &nnCount);
     void getRings(VecF<double> &x, VecF<double> &y, VecF< VecR<double> > &rings);
-    void getAreas(VecF<int> &areaHist, double adfDelta);
+    void getAreas(AreaHistogram &areaHist);
+    void bondOrder(VecF<double> &x, VecF<double> &y, double cellLen, double rCellLen, VecF< complex<double> > &psi, VecF< complex<double> > &psiW);
 };
 
 
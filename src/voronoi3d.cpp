@@ -1,33 +1,207 @@
 #include "voronoi3d.h"
 
 
-Voronoi3D::Voronoi3D(VecF<double> &x, VecF<double> &y, VecF<double> &z, VecF<double> &r, double cellLen_2, double zCut, int numA, bool radical, int maxV) {
-    //Initialise with x,y,z coordinates and radii
+Voronoi3D::Voronoi3D() {
+    //Default constructor
 
-    //Make periodic container in xy
-    n=x.n;
-    nA=numA;
-    nB=n-nA;
+    n=0;
+    nStrips=0;
+    storeFaces=false;
+}
+
+
+Voronoi3D::Voronoi3D(double cellLen_2, double zCut, int num, double rMax, int maxV) {
+    //Initialise periodic container and cell buffers once, to be refilled for each configuration
+
+    n=num;
+    nA=0;
+    nB=0;
     maxVertices=maxV;
-    int blocks=sqrt(n);
-    dz=4*vMaximum(r);
+    dz=4*rMax;
     cz=zCut;
     pbc=cellLen_2*2;
     rpbc=1.0/pbc;
+    rMaxW=rMax;
+    nStrips=0;
+    storeFaces=false;
+    vertTol=1e-10;
+    nQuanta=ceil(pbc/vertTol);
+
+    //Make periodic container in xy
+#ifdef HDMC_USE_VORO
+    int blocks=blocksPerSide(pbc,n,rMax);
     con=make_shared<voro::container_poly>(-cellLen_2,cellLen_2,-cellLen_2,cellLen_2,0,dz,
-            blocks,blocks,1,true,true,false,n);
+            blocks,blocks,1,true,true,false,max(8,2*n/(blocks*blocks)));
+#else
+    throw string("3D Voronoi analysis requires build with HDMC_USE_VORO");
+#endif
 
-    //Add particles and radii if radical
-    if(radical){
-        for(int i=0; i<n; ++i) con->put(i,x[i],y[i],z[i],r[i]);
-    }
-    else{
-        for(int i=0; i<n; ++i) con->put(i,x[i],y[i],z[i],0.0);
+    //Cell buffers
+    cellNbs3D=VecF< VecR<int> >(n);
+    for(int i=0; i<n; ++i) cellNbs3D[i]=VecR<int>(0,12*maxVertices);
+    ringCrds=VecF< VecR<double> >(n);
+    for(int i=0; i<n; ++i) ringCrds[i]=VecR<double>(0,12*maxVertices);
+    cellNbs=VecF< VecR<int> >(n);
+    for(int i=0; i<n; ++i) cellNbs[i]=VecR<int>(0,maxVertices);
+    cellAreas=VecF<double>(n);
+    cellInclude=VecF<bool>(n);
+    stripOf=VecF<int>(n);
+}
+
+
+Voronoi3D::Voronoi3D(VecF<double> &x, VecF<double> &y, VecF<double> &z, VecF<double> &r, double cellLen_2, double zCut, int numA, bool radical, int maxV) :
+        Voronoi3D(cellLen_2,zCut,x.n,vMaximum(r),maxV) {
+    //Initialise with x,y,z coordinates and radii for single configuration
+
+    compute(x,y,z,r,numA,radical);
+}
+
+
+int Voronoi3D::blocksPerSide(double cellLen, int num, double rMax) {
+    //Aim for around five particles per block column, as blocks much smaller than the largest particle only add to search
+
+    double blockLen=max(sqrt(5.0*cellLen*cellLen/num),2.0*rMax);
+    return max(1,int(cellLen/blockLen));
+}
+
+
+void Voronoi3D::compute(VecF<double> &x, VecF<double> &y, VecF<double> &z, VecF<double> &r, int numA, bool radical, int nThreads, bool faces) {
+    //Tessellate configuration, reusing container and buffers, keeping faces of all cells if requested
+
+    if(x.n!=n) throw string("Voronoi configuration does not match initialised buffers");
+    nA=numA;
+    nB=n-nA;
+
+#ifdef HDMC_USE_VORO
+    //Radii only used if radical
+    VecF<double> w(n);
+    if(radical) w=r;
+
+    //Concurrent strips where box is wide enough, otherwise single periodic container
+    storeFaces=faces;
+    faceStart.clear();
+    faceCrds.clear();
+    if(nThreads<=1 || !computeCellsStrips(x,y,z,w,nThreads)){
+        con->clear();
+        for(int i=0; i<n; ++i) con->put(i,x[i],y[i],z[i],w[i]);
+        voro::c_loop_all looper(*con);
+        voro::voronoicell_neighbor cell;
+        if(looper.start()) do{
+            int id=looper.pid();
+            double px,py,pz;
+            looper.pos(px,py,pz);
+            if(con->compute_cell(cell,looper)) projectCell(cell,id,px,py,pz,faceStart,faceCrds);
+            else hideCell(id);
+        } while(looper.inc());
     }
+    faceStart.push_back(faceCrds.size());
+#endif
 
     //Calculate cell projections
-    computeCellProjections(x,y,z);
+    computeCellProjections(nThreads);
+}
+
+
+#ifdef HDMC_USE_VORO
+void Voronoi3D::makeStrip(int s) {
+    //Container spanning strip and its halo, periodic in y only
+
+    double width=pbc/nStrips;
+    double x0=-0.5*pbc+s*width-stripHalo[s];
+    double x1=-0.5*pbc+(s+1)*width+stripHalo[s];
+    int blocks=blocksPerSide(pbc,n,rMaxW);
+    int blocksX=max(1,int(blocks*(x1-x0)/pbc));
+    stripCon[s]=make_shared<voro::container_poly>(x0,x1,-0.5*pbc,0.5*pbc,0,dz,
+            blocksX,blocks,1,false,true,false,max(8,2*n/(blocks*blocks)));
+}
+
+
+bool Voronoi3D::computeCellsStrips(VecF<double> &x, VecF<double> &y, VecF<double> &z, VecF<double> &w, int nThreads) {
+    //Calculate cells by strips in x, each with own container holding ghost images within halo
+    //a cell is exact if no particle beyond halo could cut it, otherwise halo is widened and strip repeated
+
+    //Set up strips on first use, halo of several particle spacings
+    if(nStrips!=nThreads){
+        nStrips=nThreads;
+        stripCon=vector< shared_ptr<voro::container_poly> >(nStrips);
+        stripHalo=VecF<double>(nStrips);
+        stripHalo=4.0*pbc/sqrt(double(n))+rMaxW;
+        for(int s=0; s<nStrips; ++s) makeStrip(s);
+    }
+    double width=pbc/nStrips;
+    if(width+2.0*vMaximum(stripHalo)>=pbc) return false;
+
+    //Owning strip of each particle
+    VecF<int> stripCount(nStrips);
+    for(int i=0; i<n; ++i){
+        stripOf[i]=min(nStrips-1,int((x[i]+0.5*pbc)/width));
+        ++stripCount[stripOf[i]];
+    }
+
+    //Tessellate strips concurrently, each collecting own faces
+    VecF<bool> fallback(nStrips);
+    vector< vector<int> > stripFaceStart(nStrips);
+    vector< vector<double> > stripFaceCrds(nStrips);
+    parallelFor(nThreads,0,nStrips,[&](int s0, int s1, int t){
+        voro::voronoicell_neighbor cell;
+        for(int s=s0; s<s1; ++s){
+            double xc=-0.5*pbc+(s+0.5)*width;
+            for(;;){
+                //Particles and periodic images within halo, placed once as halo is less than half box
+                double reach=0.5*width+stripHalo[s];
+                voro::container_poly &sCon=*stripCon[s];
+                sCon.clear();
+                stripFaceStart[s].clear();
+                stripFaceCrds[s].clear();
+                for(int i=0; i<n; ++i){
+                    double xs=x[i]-pbc*nearbyint((x[i]-xc)*rpbc);
+                    if(fabs(xs-xc)<reach) sCon.put(i,xs,y[i],z[i],w[i]);
+                }
+
+                //Owned cells, exact if wall is beyond furthest possible cutting particle
+                bool exact=true;
+                voro::c_loop_all looper(sCon);
+                if(looper.start()) do{
+                    int id=looper.pid();
+                    if(stripOf[id]!=s) continue;
+                    double px,py,pz;
+                    looper.pos(px,py,pz);
+                    if(!sCon.compute_cell(cell,looper)){
+                        hideCell(id);
+                        continue;
+                    }
+                    //voro++ holds vertex vectors at twice scale, so maximum is four times squared cell radius
+                    double rSq=0.25*cell.max_radius_squared();
+                    double wall=reach-fabs(px-xc);
+                    if(wall<=sqrt(rSq)+sqrt(rSq+rMaxW*rMaxW)){
+                        exact=false;
+                        break;
+                    }
+                    projectCell(cell,id,px,py,pz,stripFaceStart[s],stripFaceCrds[s]);
+                } while(looper.inc());
+                if(exact) break;
+
+                //Widen halo, unless strip and halo would cover box
+                stripHalo[s]*=1.5;
+                if(width+2.0*stripHalo[s]>=pbc){
+                    fallback[s]=true;
+                    break;
+                }
+                makeStrip(s);
+            }
+        }
+    });
+    if(vSum(fallback)>0) return false;
+
+    //Faces in strip order
+    for(int s=0; s<nStrips; ++s){
+        int offset=faceCrds.size();
+        for(int i=0; i<int(stripFaceStart[s].size()); ++i) faceStart.push_back(stripFaceStart[s][i]+offset);
+        faceCrds.insert(faceCrds.end(),stripFaceCrds[s].begin(),stripFaceCrds[s].end());
+    }
+    return true;
 }
+#endif
 
 
 void Voronoi3D::analyse(int maxSize, VecF<int> &cellSizeDistA, VecF<int> &cellSizeDistB, VecF<VecF<int> > &cellAdjDist,
@@ -106,166 +280,258 @@ void Voronoi3D::nnDistances(VecF<double> &x, VecF<double> &y, double cellLen, do
 }
 
 
-void Voronoi3D::computeCellProjections(VecF<double> &x, VecF<double> &y, VecF<double> &z) {
-    //Calculate cell projections onto plane
-    //Calculate neighbouring particles for each particle, and area of cells
+#ifdef HDMC_USE_VORO
+void Voronoi3D::projectCell(voro::voronoicell_neighbor &cell, int id, double px, double py, double pz, vector<int> &fStart, vector<double> &fCrds) {
+    //Extract 3D neighbours, projected ring and if stored faces of single cell
 
-    //Make looper
-    voro::c_loop_all looper(*con);
-    looper.start();
-
-    //Resize containers
-    VecF< VecR<int> > cellNbs3D(n); //all 3D neighbours
-    cellNbs3D=VecF< VecR<int> >(n);
-    for(int i=0; i<n; ++i) cellNbs3D[i]=VecR<int>(0,12*maxVertices);
-    ringCrds=VecF< VecR<double> >(cellNbs3D.n);
-    for(int i=0; i<cellNbs3D.n; ++i) ringCrds[i]=VecR<double>(0,12*maxVertices);
-    cellAreas=VecF<double>(n);
-    faceCrds=VecR< VecR<double> >(0,n*20);
-    cellInclude=VecF<bool>(n);
-
-    //Loop over each cell and extract neighbour ids
-    do{
-        //Find all 3D neighbours
-        int id=looper.pid(); //central id
-        voro::voronoicell_neighbor cell;
-        con->compute_cell(cell,looper);
-        vector<int> nbs;
-        cell.neighbors(nbs);
-        for(int i=0; i<nbs.size(); ++i){
-            cellNbs3D[id].addValue(nbs[i]);
-        }
-        if(vContains(cellNbs3D[id],-5)){
-            cellNbs3D[id].delValue(-5); //remove z cell boundary
-        }
-        else{
-            cout<<z[id]<<endl;
-        }
-        if(vContains(cellNbs3D[id],-6)) cellNbs3D[id].delValue(-6); //remove z cell boundary if present
-
-        //Perform horizontal cut
-        int bottomTop; //-1=bottom, 1=top face key
-        if(cz<z[id]) bottomTop=-1;
-        else bottomTop=1;
-        double cutPlane=2*(cz-z[id]);
-        cell.plane(0.0,0.0,cutPlane);
-
-        //Find faces, normals and vertices
-        vector<int> faceSizes; //number of vertices in each face
-        cell.face_orders(faceSizes);
-        int numFaces=faceSizes.size(); //number of faces
-        vector<double> normals; //normals for each face (x,y,z)
-        cell.normals(normals);
-        int keyFace=-1; //id of face on the bottom/top plane
-        for(int i=0; i<numFaces; ++i){
-            if(fabs(normals[3*i+2]-bottomTop)<1e-12){
-                keyFace=i;
-                break;
-            }
+    //Find all 3D neighbours
+    cellNbs3D[id].setSize(0);
+    ringCrds[id].setSize(0);
+    vector<int> nbs;
+    cell.neighbors(nbs);
+    for(int i=0; i<int(nbs.size()); ++i){
+        cellNbs3D[id].addValue(nbs[i]);
+    }
+    if(vContains(cellNbs3D[id],-5)){
+        cellNbs3D[id].delValue(-5); //remove z cell boundary
+    }
+    else{
+        lock_guard<mutex> guard(consoleLock());
+        cout<<pz<<endl;
+    }
+    if(vContains(cellNbs3D[id],-6)) cellNbs3D[id].delValue(-6); //remove z cell boundary if present
+
+    //Perform horizontal cut
+    int bottomTop; //-1=bottom, 1=top face key
+    if(cz<pz) bottomTop=-1;
+    else bottomTop=1;
+    double cutPlane=2*(cz-pz);
+    cell.plane(0.0,0.0,cutPlane);
+
+    //Find faces, normals and vertices
+    vector<int> faceSizes; //number of vertices in each face
+    cell.face_orders(faceSizes);
+    int numFaces=faceSizes.size(); //number of faces
+    vector<double> normals; //normals for each face (x,y,z)
+    cell.normals(normals);
+    int keyFace=-1; //id of face on the bottom/top plane
+    for(int i=0; i<numFaces; ++i){
+        if(fabs(normals[3*i+2]-bottomTop)<1e-12){
+            keyFace=i;
+            break;
         }
-        vector<int> vertexIds; //ids of vertices that make up faces
-        cell.face_vertices(vertexIds);
-        vector<double> vertexCrds; //coordinates of vertices
-        cell.vertices(vertexCrds);
-        cell.vertices(x[id], y[id], z[id], vertexCrds);
-
-        //Store coordinates for all faces
-        int k=0;
+    }
+    vector<int> vertexIds; //ids of vertices that make up faces
+    cell.face_vertices(vertexIds);
+    vector<double> vertexCrds; //coordinates of vertices
+    cell.vertices(vertexCrds);
+    cell.vertices(px, py, pz, vertexCrds);
+
+    //Store coordinates for all faces, appended to flat array
+    int k=0;
+    if(storeFaces){
         for(int i=0; i<numFaces; ++i){
-            VecR<double> fCrds(0,maxVertices*3);
+            fStart.push_back(fCrds.size());
             for(int j=0; j<faceSizes[i]+1;++j){
                 if(j>0){
-                    fCrds.addValue(vertexCrds[3*vertexIds[k]]);
-                    fCrds.addValue(vertexCrds[3*vertexIds[k]+1]);
-                    fCrds.addValue(vertexCrds[3*vertexIds[k]+2]);
+                    fCrds.push_back(vertexCrds[3*vertexIds[k]]);
+                    fCrds.push_back(vertexCrds[3*vertexIds[k]+1]);
+                    fCrds.push_back(vertexCrds[3*vertexIds[k]+2]);
                 }
                 ++k;
             }
-            faceCrds.addValue(fCrds);
         }
+    }
 
-        //Project coordinates of face on lower wall
-        if(keyFace!=-1) {
-            //Extract vertices for face
-            VecR<int> keyVertexIds(0,2*maxVertices);
-            k = 0;
-            for (int i = 0; i < numFaces; ++i) {
-                if (i == keyFace) {
-                    for (int j = 0; j < faceSizes[i] + 1; ++j) {
-                        keyVertexIds.addValue(vertexIds[k]);
-                        ++k;
-                    }
-                    break;
-                } else k += faceSizes[i] + 1;
-            }
-            for (int i = 1; i < keyVertexIds.n; ++i) {//first index gives face size
-                ringCrds[id].addValue(vertexCrds[3 * keyVertexIds[i]]);
-                ringCrds[id].addValue(vertexCrds[3 * keyVertexIds[i] + 1]);
+    //Project coordinates of face on lower wall
+    if(keyFace!=-1) {
+        //Extract vertices for face
+        VecR<int> keyVertexIds(0,2*maxVertices);
+        k = 0;
+        for (int i = 0; i < numFaces; ++i) {
+            if (i == keyFace) {
+                for (int j = 0; j < faceSizes[i] + 1; ++j) {
+                    keyVertexIds.addValue(vertexIds[k]);
+                    ++k;
+                }
+                break;
+            } else k += faceSizes[i] + 1;
+        }
+        for (int i = 1; i < keyVertexIds.n; ++i) {//first index gives face size
+            ringCrds[id].addValue(vertexCrds[3 * keyVertexIds[i]]);
+            ringCrds[id].addValue(vertexCrds[3 * keyVertexIds[i] + 1]);
 //                cout<<z[id]<<" "<<cutPlane<<" "<<vertexCrds[3*keyVertexIds[i]+2]<<endl;
+        }
+
+        //Start ring at vertex of lowest polar angle about particle, as face order depends on container
+        int nRing=ringCrds[id].n/2;
+        int first=0;
+        double angleMin=numeric_limits<double>::infinity();
+        for(int j=0; j<nRing; ++j){
+            double angle=atan2(ringCrds[id][2*j+1]-py,ringCrds[id][2*j]-px);
+            if(angle<angleMin){
+                angleMin=angle;
+                first=j;
             }
-            cellInclude[id]=true;
         }
-        else cellInclude[id]=false;
-    } while(looper.inc());
+        rotate(ringCrds[id].v,ringCrds[id].v+2*first,ringCrds[id].v+2*nRing);
+
+        cellInclude[id]=true;
+    }
+    else cellInclude[id]=false;
+}
+
+
+void Voronoi3D::hideCell(int id) {
+    //Cell removed entirely by neighbouring weights has no neighbours, ring or faces
+
+    cellNbs3D[id].setSize(0);
+    ringCrds[id].setSize(0);
+    cellInclude[id]=false;
+}
+#endif
+
+
+void Voronoi3D::computeCellProjections(int nThreads) {
+    //Calculate cell projections onto plane
+    //Calculate neighbouring particles for each particle, and area of cells
 
     //Clear cells which are not included
     for(int i=0; i<n; ++i){
-        if(!cellInclude[i]) cellNbs3D[i]=VecR<int>(0);
+        if(!cellInclude[i]) cellNbs3D[i].setSize(0);
     }
 
-    //Find neighbours of projected face only
-    cellNbs=VecF< VecR<int> >(n); //only projected neighbours
-    double tol=1e-10; //tolerance for floating point comparison
-    for(int i=0; i<n; ++i) cellNbs[i]=VecR<int>(0,maxVertices);
-    for(int id=0; id<n; ++id){
-        for(int i=0; i<cellNbs3D[id].n; ++i){
-            bool neighbour=false;
-            int nbId=cellNbs3D[id][i];
-            for(int j=0; j<ringCrds[nbId].n/2; ++j){
-                double cx0=ringCrds[nbId][2*j];
-                double cy0=ringCrds[nbId][2*j+1];
-                for(int k=0; k<ringCrds[id].n/2; ++k){
-                    double cx1=ringCrds[id][2*k];
-                    double cy1=ringCrds[id][2*k+1];
-                    double dx=cx0-cx1;
-                    double dy=cy0-cy1;
-                    dx-=pbc*nearbyint(dx*rpbc);
-                    dy-=pbc*nearbyint(dy*rpbc);
-                    if(fabs(dx)<tol && fabs(dy)<tol){
-                        neighbour=true;
-                        break;
+    //Projected neighbours are 3D neighbours sharing a ring vertex, found through vertex index
+    indexRingVertices();
+    parallelFor(nThreads,0,n,[&](int i0, int i1, int t){
+        VecF<int> mark(n); //cell last matched to each particle
+        mark=-1;
+        for(int id=i0; id<i1; ++id){
+            cellNbs[id].setSize(0);
+            for(int j=0; j<ringCrds[id].n/2; ++j){
+                double cx=ringCrds[id][2*j];
+                double cy=ringCrds[id][2*j+1];
+                long long qx,qy;
+                quantise(cx,cy,qx,qy);
+                for(int sx=-1; sx<=1; ++sx){
+                    for(int sy=-1; sy<=1; ++sy){
+                        int slot=findSlot((qx+sx+nQuanta)%nQuanta,(qy+sy+nQuanta)%nQuanta);
+                        if(slot<0) continue;
+                        for(int v=slotStart[slot]; v<slotStart[slot+1]; ++v){
+                            int u=slotVerts[v];
+                            double dx=vertX[u]-cx;
+                            double dy=vertY[u]-cy;
+                            dx-=pbc*nearbyint(dx*rpbc);
+                            dy-=pbc*nearbyint(dy*rpbc);
+                            if(fabs(dx)<vertTol && fabs(dy)<vertTol) mark[vertOwner[u]]=id;
+                        }
                     }
                 }
-                if(neighbour) break;
             }
-            if(neighbour) cellNbs[id].addValue(nbId);
+            for(int i=0; i<cellNbs3D[id].n; ++i){
+                if(mark[cellNbs3D[id][i]]==id) cellNbs[id].addValue(cellNbs3D[id][i]);
+            }
+
+            //Cell area using shoelace formula
+            cellAreas[id]=0.0;
+            if(cellInclude[id]) {
+                int nn = cellNbs[id].n;
+                for (int i = 0, j = 1; i < nn - 1; ++i, ++j) {
+                    cellAreas[id] += ringCrds[id][2 * i] * ringCrds[id][2 * j + 1];
+                    cellAreas[id] -= ringCrds[id][2 * j] * ringCrds[id][2 * i + 1];
+                }
+                cellAreas[id] += ringCrds[id][2 * (nn - 1)] * ringCrds[id][1];
+                cellAreas[id] -= ringCrds[id][0] * ringCrds[id][2 * (nn - 1) + 1];
+                cellAreas[id] = 0.5 * fabs(cellAreas[id]);
+            }
         }
+    });
+
+    //Report mismatches in particle order, held together as other tessellations may report concurrently
+    lock_guard<mutex> guard(consoleLock());
+    for(int id=0; id<n; ++id){
         if(cellNbs[id].n!=ringCrds[id].n/2) cout<<"Error in 3D Voronoi neighbours "<<cellNbs[id].n<<" "<<ringCrds[id].n/2<<endl;
     }
+}
+
+
+void Voronoi3D::quantise(double cx, double cy, long long &qx, long long &qy) {
+    //Integer coordinates of point on grid of tolerance spacing, wrapped into periodic box
+
+    qx=floor((cx-pbc*floor(cx*rpbc+0.5)+0.5*pbc)/vertTol);
+    qy=floor((cy-pbc*floor(cy*rpbc+0.5)+0.5*pbc)/vertTol);
+    qx=((qx%nQuanta)+nQuanta)%nQuanta;
+    qy=((qy%nQuanta)+nQuanta)%nQuanta;
+}
+
+
+int Voronoi3D::findSlot(long long qx, long long qy) {
+    //Slot of quantised coordinates in hash table, -1 if absent
+
+    size_t mask=slotTable.size()-1;
+    size_t h=(size_t(qx)*0x9E3779B97F4A7C15ull^size_t(qy)*0xC2B2AE3D27D4EB4Full)&mask;
+    for(;;){
+        int slot=slotTable[h];
+        if(slot<0 || (slotQx[slot]==qx && slotQy[slot]==qy)) return slot;
+        h=(h+1)&mask;
+    }
+}
+
 
-    //Calculate cell areas using shoelace formula
+void Voronoi3D::indexRingVertices() {
+    //Hash every ring vertex by quantised coordinates, vertices grouped contiguously by slot
+    //matching vertices lie in same or adjacent slots, so each lookup is constant time
+
+    vertX.clear();
+    vertY.clear();
+    vertOwner.clear();
     for(int id=0; id<n; ++id){
-        if(cellInclude[id]) {
-            int nn = cellNbs[id].n;
-            for (int i = 0, j = 1; i < nn - 1; ++i, ++j) {
-                cellAreas[id] += ringCrds[id][2 * i] * ringCrds[id][2 * j + 1];
-                cellAreas[id] -= ringCrds[id][2 * j] * ringCrds[id][2 * i + 1];
-            }
-            cellAreas[id] += ringCrds[id][2 * (nn - 1)] * ringCrds[id][1];
-            cellAreas[id] -= ringCrds[id][0] * ringCrds[id][2 * (nn - 1) + 1];
-            cellAreas[id] = 0.5 * fabs(cellAreas[id]);
+        for(int j=0; j<ringCrds[id].n/2; ++j){
+            vertX.push_back(ringCrds[id][2*j]);
+            vertY.push_back(ringCrds[id][2*j+1]);
+            vertOwner.push_back(id);
         }
     }
+    int nV=vertX.size();
+
+    //Open addressing table at most half full
+    size_t size=2;
+    while(size<2*size_t(nV)) size*=2;
+    slotTable.assign(size,-1);
+    slotQx.clear();
+    slotQy.clear();
+    vector<int> vertSlot(nV);
+    size_t mask=size-1;
+    for(int u=0; u<nV; ++u){
+        long long qx,qy;
+        quantise(vertX[u],vertY[u],qx,qy);
+        size_t h=(size_t(qx)*0x9E3779B97F4A7C15ull^size_t(qy)*0xC2B2AE3D27D4EB4Full)&mask;
+        while(slotTable[h]>=0 && !(slotQx[slotTable[h]]==qx && slotQy[slotTable[h]]==qy)) h=(h+1)&mask;
+        if(slotTable[h]<0){
+            slotTable[h]=slotQx.size();
+            slotQx.push_back(qx);
+            slotQy.push_back(qy);
+        }
+        vertSlot[u]=slotTable[h];
+    }
+
+    //Counting sort of vertices by slot
+    int nSlots=slotQx.size();
+    slotStart.assign(nSlots+1,0);
+    for(int u=0; u<nV; ++u) ++slotStart[vertSlot[u]+1];
+    for(int i=0; i<nSlots; ++i) slotStart[i+1]+=slotStart[i];
+    slotVerts.resize(nV);
+    vector<int> fill(slotStart.begin(),slotStart.end()-1);
+    for(int u=0; u<nV; ++u) slotVerts[fill[vertSlot[u]]++]=u;
 }
 
 
-void Voronoi3D::getAreas(VecF<int> &areaHist, double adfDelta) {
+void Voronoi3D::getAreas(AreaHistogram &areaHist) {
     //Add areas of each cell to histogram
 
     for(int i=0; i<n; ++i) {
         if (cellInclude[i]) {
-            int b = floor(cellAreas[i]/adfDelta);
-            ++areaHist[b];
+            areaHist.add(cellAreas[i]);
         }
     }
 }
@@ -278,10 +544,10 @@ VecF< VecR<double> > Voronoi3D::getProjectedRings() {
 }
 
 
-VecR< VecR<double> > Voronoi3D::getFaces(VecF<double> &zLimits) {
-    //Get face coordinates
+int Voronoi3D::getFaces(VecF<double> &zLimits) {
+    //Get height limits and number of faces, coordinates of face i are faceCrds[faceStart[i]] to faceCrds[faceStart[i+1]]
 
     zLimits=VecF<double>(2);
     zLimits[1]=dz;
-    return faceCrds;
+    return faceStart.size()-1;
 }
\ No newline at end of file
@@ -7,11 +7,17 @@
 #include <iomanip>
 #include <vector>
 #include <memory>
+#include <algorithm>
+#include <limits>
 #include "outputfile.h"
 #include "vecf.h"
 #include "vecr.h"
 #include "vec_func.h"
-#include "../voro++/src/voro++.hh"
+#include "parallel.h"
+#include "areahistogram.h"
+#ifdef HDMC_USE_VORO
+#include "voro++.hh"
+#endif
 
 using namespace std;
 
@@ -21,31 +27,65 @@ class Voronoi3D {
 private:
 
     //Data members
+#ifdef HDMC_USE_VORO
     shared_ptr<voro::container_poly> con;
+#endif
     int n,nA,nB; //total number of particles and of type A, B
     int maxVertices; //maximum number of vertices per cell
     double dz,cz; //height of cells, horizontal cut
     double pbc,rpbc; //periodic boundary conditions
     VecF< VecR<int> > cellNbs; //neighbours of each cell
+    VecF< VecR<int> > cellNbs3D; //all 3D neighbours of each cell
     VecF<double> cellAreas; //areas of each cell
     VecF< VecR<double> > ringCrds; //coordinates of rings
-    VecR< VecR<double> > faceCrds; //coordinates of all faces
+    bool storeFaces; //keep faces of current configuration
     VecF<bool> cellInclude; //whether cells are included
+    double rMaxW; //largest radius
+    int nStrips; //strips for concurrent tessellation, 0 if not set up
+#ifdef HDMC_USE_VORO
+    vector< shared_ptr<voro::container_poly> > stripCon; //container for each strip and its ghost halo
+#endif
+    VecF<double> stripHalo; //ghost halo width of each strip
+    VecF<int> stripOf; //strip owning each particle
+    double vertTol; //tolerance for matching ring vertices
+    long long nQuanta; //tolerance grid points along each side
+    vector<double> vertX,vertY; //all ring vertex coordinates
+    vector<int> vertOwner; //cell of each ring vertex
+    vector<int> slotTable; //hash table of slots for quantised coordinates
+    vector<long long> slotQx,slotQy; //quantised coordinates of each slot
+    vector<int> slotStart,slotVerts; //vertices in each slot
 
     //Member functions
-    void computeCellProjections(VecF<double> &x, VecF<double> &y, VecF<double> &z); //find neighbours for each cell projection
+    static int blocksPerSide(double cellLen, int num, double rMax); //container blocks along each side
+#ifdef HDMC_USE_VORO
+    void projectCell(voro::voronoicell_neighbor &cell, int id, double px, double py, double pz, vector<int> &fStart, vector<double> &fCrds); //3D neighbours, projected ring and faces of cell
+    void hideCell(int id); //empty cell with no projection
+    void makeStrip(int s); //container for strip and its halo
+    bool computeCellsStrips(VecF<double> &x, VecF<double> &y, VecF<double> &z, VecF<double> &w, int nThreads); //cells concurrently by strips, false if strips too narrow
+#endif
+    void quantise(double cx, double cy, long long &qx, long long &qy); //coordinates on tolerance grid
+    int findSlot(long long qx, long long qy); //hash table slot of quantised coordinates
+    void indexRingVertices(); //hash ring vertices of all cells
+    void computeCellProjections(int nThreads); //find neighbours for each cell projection
 
 public:
 
-    //Constructor
+    //Data members
+    vector<int> faceStart; //offset of each face in faceCrds, filled only when faces requested
+    vector<double> faceCrds; //x,y,z coordinates of vertices of all faces
+
+    //Constructors
+    Voronoi3D();
+    Voronoi3D(double cellLen_2, double zCut, int num, double rMax, int maxV); //box and buffers, reused for each configuration
     Voronoi3D(VecF<double> &x, VecF<double> &y, VecF<double> &z, VecF<double> &r, double cellLen_2, double zCut, int numA, bool radical, int maxV); //3D coordinates and radii, cell info
 
     //Member functions
+    void compute(VecF<double> &x, VecF<double> &y, VecF<double> &z, VecF<double> &r, int numA, bool radical, int nThreads=1, bool faces=false); //clear and tessellate configuration
     void analyse(int maxSize, VecF<int> &cellSizeDistA, VecF<int> &cellSizeDistB, VecF< VecF<int> > &cellAdjDist, VecF<double> &cellAreaA, VecF<double> &cellAreaB);
     void nnDistances(VecF<double> &x, VecF<double> &y, double cellLen, double rCellLen, VecF<double> &nnSep, VecF<int> &nnCount);
-    void getAreas(VecF<int> &areaHist, double adfDelta);
+    void getAreas(AreaHistogram &areaHist);
     VecF< VecR<double> > getProjectedRings();
-    VecR< VecR<double> > getFaces(VecF<double> &zLimits);
+    int getFaces(VecF<double> &zLimits);
 };
 
 